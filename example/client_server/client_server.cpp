@@ -160,41 +160,12 @@ public:
     }
 
 protected:
-    void process_request(httpony::Request& request) override
-    {
-        httpony::AsyncClient::process_request(request);
-
-        // Clear old cookies
-        melanolib::time::DateTime now;
-        cookies.erase(
-            std::remove_if(cookies.begin(), cookies.end(),
-                [&now](const auto& cookie) {
-                    return cookie.second.expired(now);
-                }
-            ),
-            cookies.end()
-        );
-
-        // Set request cookies
-        for ( const auto& cookie : cookies )
-        {
-            if ( cookie.second.matches_uri(request.uri) )
-                request.cookies[cookie.first] = cookie.second.value;
-        }
-    }
-
     void process_response(httpony::Request& request, httpony::Response& response) override
     {
         std::cout.clear();
         std::cout << "=============\nClient:\n";
         httpony::Http1Formatter("\n").response(std::cout, response);
         std::cout << "\n=============\n";
-
-        for ( const auto& cookie : response.cookies )
-        {
-            if ( cookie.second.matches_domain(request.uri.authority.host) )
-                cookies.append(cookie.first, cookie.second);
-        }
     }
 
 private:
@@ -217,8 +188,6 @@ private:
             std::cout << "Client: Request finished\n";
         }
     }
-
-    httpony::ClientCookieJar cookies;
 };
 
 
@@ -19,6 +19,7 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <fstream>
+#include <mutex>
 
 #include <boost/filesystem.hpp>
 #include <magic.h>
@@ -36,6 +37,11 @@ public:
     {
         magic_cookie = magic_open(MAGIC_SYMLINK|MAGIC_MIME_TYPE);
         magic_load(magic_cookie, nullptr);
+        mime_types.load_mime_types();
+        // Reading the file contents is only needed for unknown extensions
+        mime_types.set_sniffer([this](const std::string& filename) {
+            return sniff_mime_type(filename);
+        });
         set_timeout(melanolib::time::seconds(16));
     }
 
@@ -74,31 +80,31 @@ protected:
                 using namespace httpony::quick_xml::html;
                 httpony::Response response(request.protocol);
                 response.body.start_output("text/html");
-                HtmlDocument html(file.string());
-                auto& list = html.body().append(List{});
-
-                if ( !request.uri.path.empty() )
                 {
-                    list.add_item(Link{"..", "Parent"});
+                    // Streams the listing without building a tree for it
+                    HtmlWriter html(response.body, file.string(), true);
+                    auto list = html.block_element("ul");
+
+                    if ( !request.uri.path.empty() )
+                    {
+                        auto item = html.block_element("li");
+                        html.link("..", "Parent");
+                    }
+
+                    for ( const auto& item : boost::filesystem::directory_iterator(file) )
+                    {
+                        std::string basename = item.path().filename().string();
+                        auto list_item = html.block_element("li");
+                        html.link((request.uri.path / basename).url_encoded(), basename);
+                    }
                 }
-
-                for ( const auto& item : boost::filesystem::directory_iterator(file) )
-                {
-                    std::string basename = item.path().filename().string();
-                    list.add_item(Link{
-                        (request.uri.path / basename).url_encoded(),
-                        basename
-                    });
-                }
-
-                html.print(response.body, true);
                 response.body << '\n';
                 return response;
             }
             else if ( boost::filesystem::is_regular(file) )
             {
                 httpony::Response response(request.protocol);
-                response.body.start_output(mime_type(file.string()));
+                response.body.start_output(mime_types.resolve(file.string()));
                 std::ifstream input(file.string());
                 while ( input )
                 {
@@ -156,23 +162,27 @@ protected:
     }
 
     /**
-     * \brief Returns the Mime type from a file name
+     * \brief Returns the Mime type from the contents of a file
      */
-    httpony::MimeType mime_type(const std::string& filename) const
+    httpony::MimeType sniff_mime_type(const std::string& filename)
     {
+        // libmagic cookies can't be used by multiple threads at once
+        std::lock_guard<std::mutex> lock(magic_mutex);
         if ( magic_cookie )
         {
             const char* mime = magic_file(magic_cookie, filename.c_str());
             if ( mime )
                 return httpony::MimeType(mime);
         }
-        return httpony::MimeType("application", "octet-stream");
+        return {};
     }
 
 private:
     boost::filesystem::path root;
     std::string log_format = "%h %l %u %t \"%r\" %s %b \"%{Referer}i\" \"%{User-Agent}i\"";
     magic_t magic_cookie;
+    std::mutex magic_mutex;
+    mutable httpony::MimeResolver mime_types;
 };
 
 /**
@@ -28,7 +28,11 @@
 #include "httpony/http/post/form_data.hpp"
 #include "httpony/http/post/urlencoded.hpp"
 #include "httpony/base_encoding.hpp"
+#include "httpony/base_encoding_stream.hpp"
+#include "httpony/mime_resolver.hpp"
 #include "httpony/formats/quick_xml.hpp"
+#include "httpony/formats/quick_xml_stream.hpp"
+#include "httpony/formats/quick_xml_template.hpp"
 #include "httpony/formats/json.hpp"
 
 #endif // HTTPONY_HPP
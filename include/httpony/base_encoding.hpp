@@ -23,8 +23,14 @@
 #define HTTPONY_BASE_ENCODING_HPP
 
 /// \cond
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 
+#if defined(__SSSE3__)
+#   include <tmmintrin.h>
+#endif
+
 #include <melanolib/utils/gsl.hpp>
 #include <melanolib/string/ascii.hpp>
 /// \endcond
@@ -55,6 +61,38 @@ public:
         return encoding_name;
     }
 
+    /**
+     * \brief Number of bytes in an unencoded group
+     */
+    std::size_t unencoded_group_size() const
+    {
+        return u_grp_count * u_grp_size / 8;
+    }
+
+    /**
+     * \brief Number of characters in an encoded group
+     */
+    std::size_t encoded_group_size() const
+    {
+        return e_grp_count;
+    }
+
+    /**
+     * \brief Whether the last group is padded to encoded_group_size()
+     */
+    bool padded() const
+    {
+        return pad;
+    }
+
+    /**
+     * \brief Character used for padding
+     */
+    char padding_character() const
+    {
+        return padding;
+    }
+
     /**
      * \brief Encodes \p input
      * \returns The base-encoded string
@@ -84,10 +122,29 @@ public:
     void encode(const std::string& input, std::string& output) const
     {
         output.clear();
-        output.reserve(encoded_size(input.size()));
-
-        encode(
+        encode_append(
             byte_view(reinterpret_cast<const byte*>(input.data()), input.size()),
+            output
+        );
+    }
+
+    /**
+     * \brief Encodes \p input appending the result to \p output
+     */
+    void encode_append(byte_view input, std::string& output) const
+    {
+        output.reserve(output.size() + encoded_size(input.size()));
+
+        // Whole groups are encoded in place, the rest by the generic algorithm
+        std::size_t start = output.size();
+        std::size_t blocks = input.size() - input.size() % u_grp_count;
+        output.resize(start + blocks / u_grp_count * e_grp_count);
+        std::size_t consumed = blocks ?
+            encode_block(input.data(), blocks, reinterpret_cast<byte*>(&output[start])) : 0;
+        output.resize(start + consumed / u_grp_count * e_grp_count);
+
+        encode_generic(
+            byte_view(input.data() + consumed, input.size() - consumed),
             std::back_inserter(output)
         );
     }
@@ -100,40 +157,21 @@ public:
     template<class OutputIterator>
         void encode(byte_view input, OutputIterator output) const
     {
-        uint64_t group = 0;
-        int count = 0;
-
-        // Convert u_grp_count groups of u_grp_size bits
-        // into e_grp_count groups of e_grp_size
-        for ( auto bin : input )
+        byte buffer[block_buffer_size];
+        const std::size_t chunk_size = block_buffer_size / e_grp_count * u_grp_count;
+        std::size_t blocks = input.size() - input.size() % u_grp_count;
+        std::size_t offset = 0;
+        while ( offset < blocks )
         {
-            group = (group << u_grp_size) | bin;
-            count++;
-            if ( count == u_grp_count )
-            {
-                encode_bits(group, output, u_grp_size * u_grp_count);
-                group = 0;
-                count = 0;
-            }
+            std::size_t size = std::min(chunk_size, blocks - offset);
+            std::size_t consumed = encode_block(input.data() + offset, size, buffer);
+            output = std::copy(buffer, buffer + consumed / u_grp_count * e_grp_count, output);
+            offset += consumed;
+            if ( consumed < size )
+                break;
         }
 
-        // Handle stray octects
-        if ( count )
-        {
-            // Encode available bits
-            encode_bits(group, output, count * u_grp_size);
-
-            // Append padding characters
-            if ( pad )
-            {
-                int remaining = ((u_grp_count * u_grp_size) - (count * u_grp_size)) / e_grp_size;
-                for ( int i = 0; i < remaining; i++ )
-                {
-                    *output = padding;
-                    ++output;
-                }
-            }
-        }
+        encode_generic(byte_view(input.data() + offset, input.size() - offset), output);
     }
 
 
@@ -172,11 +210,10 @@ public:
     bool decode(const std::string& input, std::string& output) const
     {
         output.clear();
-        output.reserve(decoded_size(input.size()));
 
-        bool encoded = decode(
+        bool encoded = decode_append(
             byte_view(reinterpret_cast<const byte*>(input.data()), input.size()),
-            std::back_inserter(output)
+            output
         );
 
         if ( !encoded )
@@ -185,6 +222,32 @@ public:
         return encoded;
     }
 
+    /**
+     * \brief Decodes \p input appending the result to \p output
+     * \return \b true on succees, on failure \p output contains
+     *         some unspecified partial result
+     */
+    bool decode_append(byte_view input, std::string& output) const
+    {
+        if ( pad && input.size() % e_grp_count )
+            return false;
+
+        output.reserve(output.size() + decoded_size(input.size()));
+
+        // Whole groups are decoded in place, the rest by the generic algorithm
+        std::size_t start = output.size();
+        std::size_t blocks = decode_block_prefix(input.size());
+        output.resize(start + blocks / e_grp_count * u_grp_count);
+        std::size_t consumed = blocks ?
+            decode_block(input.data(), blocks, reinterpret_cast<byte*>(&output[start])) : 0;
+        output.resize(start + consumed / e_grp_count * u_grp_count);
+
+        return decode_generic(
+            byte_view(input.data() + consumed, input.size() - consumed),
+            std::back_inserter(output)
+        );
+    }
+
     /**
      * \brief Decodes \p input into \p output
      * \param input     View to a base-encoded byte string
@@ -197,6 +260,146 @@ public:
         if ( pad && input.size() % e_grp_count )
             return false;
 
+        byte buffer[block_buffer_size];
+        const std::size_t chunk_size = block_buffer_size / u_grp_count * e_grp_count;
+        std::size_t blocks = decode_block_prefix(input.size());
+        std::size_t offset = 0;
+        while ( offset < blocks )
+        {
+            std::size_t size = std::min(chunk_size, blocks - offset);
+            std::size_t consumed = decode_block(input.data() + offset, size, buffer);
+            output = std::copy(buffer, buffer + consumed / e_grp_count * u_grp_count, output);
+            offset += consumed;
+            if ( consumed < size )
+                break;
+        }
+
+        return decode_generic(byte_view(input.data() + offset, input.size() - offset), output);
+    }
+
+protected:
+    explicit BaseBase(
+        int u_grp_size,
+        int u_grp_count,
+        int e_grp_size,
+        int e_grp_count,
+        bool pad,
+        char padding,
+        const char* encoding_name
+    )
+        : u_grp_size(u_grp_size),
+          u_grp_count(u_grp_count),
+          e_grp_size(e_grp_size),
+          e_grp_count(e_grp_count),
+          u2e_bitmask((1 << e_grp_size) - 1),
+          e2u_bitmask((1 << u_grp_size) - 1),
+          pad(pad),
+          padding(padding),
+          encoding_name(encoding_name)
+    {}
+
+private:
+    /**
+     * \brief Size of the buffers used by the block algorithms
+     * when writing to an output iterator
+     */
+    static constexpr std::size_t block_buffer_size = 1024;
+
+    /**
+     * \brief Encodes whole groups at once, for encodings with a
+     * specialized algorithm
+     * \param input  Unencoded data, \p size is a multiple of u_grp_count
+     * \param output Buffer with room for the encoded groups
+     * \returns The number of bytes consumed from \p input,
+     *          a multiple of u_grp_count
+     */
+    virtual std::size_t encode_block(const byte* input, std::size_t size, byte* output) const
+    {
+        return 0;
+    }
+
+    /**
+     * \brief Decodes whole groups at once, for encodings with a
+     * specialized algorithm
+     * \param input  Encoded data, \p size is a multiple of e_grp_count
+     * \param output Buffer with room for the decoded groups
+     * \returns The number of bytes consumed from \p input,
+     *          a multiple of e_grp_count.
+     *          It stops at the first group which contains padding or
+     *          invalid characters, leaving it to the generic algorithm.
+     */
+    virtual std::size_t decode_block(const byte* input, std::size_t size, byte* output) const
+    {
+        return 0;
+    }
+
+    /**
+     * \brief Size of the input passed to decode_block()
+     *
+     * The last group is always left to the generic algorithm as it
+     * might contain padding.
+     */
+    std::size_t decode_block_prefix(std::size_t size) const
+    {
+        std::size_t group = e_grp_count;
+        if ( size <= group )
+            return 0;
+        size -= group;
+        return size - size % group;
+    }
+
+    /**
+     * \brief Encodes one unencoded group at a time
+     */
+    template<class OutputIterator>
+        void encode_generic(byte_view input, OutputIterator output) const
+    {
+        uint64_t group = 0;
+        int count = 0;
+
+        // Convert u_grp_count groups of u_grp_size bits
+        // into e_grp_count groups of e_grp_size
+        for ( auto bin : input )
+        {
+            group = (group << u_grp_size) | bin;
+            count++;
+            if ( count == u_grp_count )
+            {
+                encode_bits(group, output, u_grp_size * u_grp_count);
+                group = 0;
+                count = 0;
+            }
+        }
+
+        // Handle stray octects
+        if ( count )
+        {
+            // Encode available bits
+            encode_bits(group, output, count * u_grp_size);
+
+            // Append padding characters
+            if ( pad )
+            {
+                int remaining = ((u_grp_count * u_grp_size) - (count * u_grp_size)) / e_grp_size;
+                for ( int i = 0; i < remaining; i++ )
+                {
+                    *output = padding;
+                    ++output;
+                }
+            }
+        }
+    }
+
+
+    /**
+     * \brief Decodes one encoded group at a time
+     */
+    template<class OutputIterator>
+        bool decode_generic(byte_view input, OutputIterator output) const
+    {
+        if ( pad && input.size() % e_grp_count )
+            return false;
+
         uint64_t group = 0;
         int count = 0;
         std::size_t i = 0;
@@ -237,29 +440,6 @@ public:
         return true;
     }
 
-protected:
-    explicit BaseBase(
-        int u_grp_size,
-        int u_grp_count,
-        int e_grp_size,
-        int e_grp_count,
-        bool pad,
-        char padding,
-        const char* encoding_name
-    )
-        : u_grp_size(u_grp_size),
-          u_grp_count(u_grp_count),
-          e_grp_size(e_grp_size),
-          e_grp_count(e_grp_count),
-          u2e_bitmask((1 << e_grp_size) - 1),
-          e2u_bitmask((1 << u_grp_size) - 1),
-          pad(pad),
-          padding(padding),
-          encoding_name(encoding_name)
-    {}
-
-private:
-
     /**
      * \brief Converts a e_grp_size-bit integer into a base-encoded 8-bit character
      * \param data e_grp_size-bit integer [0, 64)
@@ -336,9 +516,303 @@ private:
 
 };
 
+namespace detail {
+
+    constexpr int gcd(int a, int b)
+    {
+        return b == 0 ? a : gcd(b, a % b);
+    }
+
+    /**
+     * \brief Converts whole groups with group sizes known at compile time
+     * \tparam Bits Number of bits encoded by each character
+     */
+    template<int Bits>
+        struct BaseKernel
+    {
+        /// Number of bytes in a group
+        static constexpr int group_bytes = Bits / gcd(8, Bits);
+        /// Number of characters in a group
+        static constexpr int group_chars = 8 / gcd(8, Bits);
+        /// Value marking invalid characters in decoding tables
+        static constexpr byte invalid = 0xff;
+
+        /**
+         * \brief Encodes all the groups in \p input
+         * \returns The number of bytes consumed
+         */
+        static std::size_t encode(const byte* table, const byte* input, std::size_t size, byte* output)
+        {
+            const byte* begin = input;
+            for ( const byte* end = input + size - size % group_bytes; input != end;
+                  input += group_bytes, output += group_chars )
+            {
+                uint64_t group = 0;
+                for ( int i = 0; i < group_bytes; i++ )
+                    group = (group << 8) | input[i];
+                for ( int i = 0; i < group_chars; i++ )
+                    output[i] = table[(group >> (Bits * (group_chars - 1 - i))) & ((1 << Bits) - 1)];
+            }
+            return input - begin;
+        }
+
+        /**
+         * \brief Decodes groups from \p input, stopping at the first
+         * one with characters not in \p table
+         * \returns The number of characters consumed
+         */
+        static std::size_t decode(const byte* table, const byte* input, std::size_t size, byte* output)
+        {
+            const byte* begin = input;
+            for ( const byte* end = input + size - size % group_chars; input != end;
+                  input += group_chars, output += group_bytes )
+            {
+                uint64_t group = 0;
+                byte flags = 0;
+                for ( int i = 0; i < group_chars; i++ )
+                {
+                    byte value = table[input[i]];
+                    flags |= value;
+                    group = (group << Bits) | value;
+                }
+                if ( flags & 0x80 )
+                    break;
+                for ( int i = 0; i < group_bytes; i++ )
+                    output[i] = group >> (8 * (group_bytes - 1 - i));
+            }
+            return input - begin;
+        }
+    };
+
+    /**
+     * \brief Encoding and decoding tables
+     */
+    struct AlphabetTables
+    {
+        byte encode[64];
+        byte decode[256];
+    };
+
+    /**
+     * \brief Generates the tables from an alphabet class
+     *
+     * The alphabet has a static constant \c bits and static constexpr
+     * functions \c encode(byte value) and \c decode(byte character),
+     * the latter returns BaseKernel::invalid for characters not in the alphabet.
+     */
+    template<class Alphabet>
+        constexpr AlphabetTables make_alphabet_tables()
+    {
+        AlphabetTables tables{};
+        for ( int i = 0; i < (1 << Alphabet::bits); i++ )
+            tables.encode[i] = Alphabet::encode(i);
+        for ( int i = 0; i < 256; i++ )
+            tables.decode[i] = Alphabet::decode(i);
+        return tables;
+    }
+
+    template<class Alphabet>
+        struct StaticAlphabet
+    {
+        static constexpr AlphabetTables tables = make_alphabet_tables<Alphabet>();
+    };
+
+    template<class Alphabet>
+        constexpr AlphabetTables StaticAlphabet<Alphabet>::tables;
+
+    struct Base32Alphabet
+    {
+        static constexpr int bits = 5;
+
+        static constexpr byte encode(byte value)
+        {
+            return value < 26 ? 'A' + value : '2' + (value - 26);
+        }
+
+        static constexpr byte decode(byte c)
+        {
+            return c >= '2' && c <= '7' ? c - '2' + 26 :
+                   c >= 'a' && c <= 'z' ? c - 'a' :
+                   c >= 'A' && c <= 'Z' ? c - 'A' :
+                   BaseKernel<bits>::invalid;
+        }
+    };
+
+    struct Base32HexAlphabet
+    {
+        static constexpr int bits = 5;
+
+        static constexpr byte encode(byte value)
+        {
+            return value < 10 ? '0' + value : 'A' + (value - 10);
+        }
+
+        static constexpr byte decode(byte c)
+        {
+            return c >= '0' && c <= '9' ? c - '0' :
+                   c >= 'a' && c <= 'v' ? c - 'a' + 10 :
+                   c >= 'A' && c <= 'V' ? c - 'A' + 10 :
+                   BaseKernel<bits>::invalid;
+        }
+    };
+
+    struct Base16Alphabet
+    {
+        static constexpr int bits = 4;
+
+        static constexpr byte encode(byte value)
+        {
+            return value < 10 ? '0' + value : 'A' + (value - 10);
+        }
+
+        static constexpr byte decode(byte c)
+        {
+            return c >= '0' && c <= '9' ? c - '0' :
+                   c >= 'a' && c <= 'f' ? c - 'a' + 10 :
+                   c >= 'A' && c <= 'F' ? c - 'A' + 10 :
+                   BaseKernel<bits>::invalid;
+        }
+    };
+
+#if defined(__SSSE3__)
+    /**
+     * \brief Encodes 12 bytes into 16 base 64 characters
+     * \param input    Reads 16 bytes
+     * \param c62      The 62nd character of the alphabet
+     * \param c63      The 63rd character of the alphabet
+     * \see http://0x80.pl/notesen/2016-01-12-sse-base64-encoding.html
+     */
+    inline void base64_encode_simd(const byte* input, byte* output, byte c62, byte c63)
+    {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+        in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+
+        // Splits each 3 byte group into 4 sextets, one per byte
+        __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+        __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+        __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+        __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+        __m128i indices = _mm_or_si128(t1, t3);
+
+        // Maps the sextet ranges to the offset to add to get the character
+        __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+        __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+        range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+        const __m128i offsets = _mm_setr_epi8(
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            char(c62 - 62), char(c63 - 63), 'A', 0, 0
+        );
+        __m128i result = _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output), result);
+    }
+
+    inline __m128i base64_in_range(__m128i input, char min, char max)
+    {
+        return _mm_and_si128(
+            _mm_cmpgt_epi8(input, _mm_set1_epi8(min - 1)),
+            _mm_cmpgt_epi8(_mm_set1_epi8(max + 1), input)
+        );
+    }
+
+    /**
+     * \brief Decodes 16 base 64 characters into 12 bytes
+     * \param output    Writes 16 bytes
+     * \returns \b false if \p input contains characters outside the alphabet
+     * \see http://0x80.pl/notesen/2016-01-17-sse-base64-decoding.html
+     */
+    inline bool base64_decode_simd(const byte* input, byte* output, byte c62, byte c63)
+    {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+
+        __m128i is62 = _mm_cmpeq_epi8(in, _mm_set1_epi8(c62));
+        __m128i is63 = _mm_andnot_si128(is62, _mm_cmpeq_epi8(in, _mm_set1_epi8(c63)));
+        __m128i special = _mm_or_si128(is62, is63);
+        __m128i upper = _mm_andnot_si128(special, base64_in_range(in, 'A', 'Z'));
+        __m128i lower = _mm_andnot_si128(special, base64_in_range(in, 'a', 'z'));
+        __m128i digit = _mm_andnot_si128(special, base64_in_range(in, '0', '9'));
+
+        __m128i valid = _mm_or_si128(_mm_or_si128(special, upper), _mm_or_si128(lower, digit));
+        if ( _mm_movemask_epi8(valid) != 0xffff )
+            return false;
+
+        __m128i values = _mm_or_si128(
+            _mm_or_si128(
+                _mm_and_si128(upper, _mm_sub_epi8(in, _mm_set1_epi8('A'))),
+                _mm_and_si128(lower, _mm_sub_epi8(in, _mm_set1_epi8('a' - 26)))
+            ),
+            _mm_or_si128(
+                _mm_and_si128(digit, _mm_add_epi8(in, _mm_set1_epi8(52 - '0'))),
+                _mm_or_si128(
+                    _mm_and_si128(is62, _mm_set1_epi8(62)),
+                    _mm_and_si128(is63, _mm_set1_epi8(63))
+                )
+            )
+        );
+
+        // Packs 4 sextets into 3 bytes
+        __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+        __m128i groups = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+        groups = _mm_shuffle_epi8(groups, _mm_setr_epi8(
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+        ));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output), groups);
+        return true;
+    }
+#   define HTTPONY_BASE64_SIMD 1
+#endif
+
+} // namespace detail
+
+/**
+ * \brief Base encoding with an alphabet known at compile time
+ * \tparam Alphabet Alphabet class as described in detail::make_alphabet_tables()
+ */
+template<class Alphabet>
+    class StaticBaseEncoding : public BaseBase
+{
+protected:
+    using Kernel = detail::BaseKernel<Alphabet::bits>;
+
+    StaticBaseEncoding(bool pad, const char* encoding_name)
+        : BaseBase(8, Kernel::group_bytes, Alphabet::bits, Kernel::group_chars,
+                   pad, '=', encoding_name)
+    {}
+
+private:
+    static const detail::AlphabetTables& tables()
+    {
+        return detail::StaticAlphabet<Alphabet>::tables;
+    }
+
+    byte encode_group(byte data) const override
+    {
+        return tables().encode[data];
+    }
+
+    bool decode_group(byte data, byte& output) const override
+    {
+        output = tables().decode[data];
+        return output != Kernel::invalid;
+    }
+
+    std::size_t encode_block(const byte* input, std::size_t size, byte* output) const override
+    {
+        return Kernel::encode(tables().encode, input, size, output);
+    }
+
+    std::size_t decode_block(const byte* input, std::size_t size, byte* output) const override
+    {
+        return Kernel::decode(tables().decode, input, size, output);
+    }
+};
+
 /**
  * \brief Base 64 encoding
  * \see https://tools.ietf.org/html/rfc4648#section-4
+ *
+ * Whole groups are converted 3 bytes at a time with lookup tables,
+ * or 12 at a time with SSSE3 when available.
  */
 class Base64 : public BaseBase
 {
@@ -351,7 +825,15 @@ public:
     Base64(byte c62, byte c63, bool pad = true)
         : BaseBase(8, 3, 6, 4, pad, '=', "Base 64"),
         c62(c62), c63(c63)
-    {}
+    {
+        for ( byte i = 0; i < 64; i++ )
+            encode_table[i] = encode_group(i);
+
+        // Later entries take precedence: c63, c62, digits, lower, upper
+        std::memset(decode_table, Kernel::invalid, sizeof(decode_table));
+        for ( byte i = 0; i < 64; i++ )
+            decode_table[encode_table[i]] = i;
+    }
 
     explicit Base64(bool pad) : Base64('+', '/', pad)
     {}
@@ -361,6 +843,8 @@ public:
 
 
 private:
+    using Kernel = detail::BaseKernel<6>;
+
     byte encode_group(byte data) const override
     {
         if ( data < 26 )
@@ -378,130 +862,106 @@ private:
 
     bool decode_group(byte data, byte& output) const override
     {
-        if ( data == c63 )
-            output = 63;
-        else if ( data == c62 )
-            output = 62;
-        else if ( melanolib::string::ascii::is_digit(data) )
-            output = data - '0' + 52;
-        else if ( melanolib::string::ascii::is_lower(data) )
-            output = data - 'a' + 26;
-        else if ( melanolib::string::ascii::is_upper(data) )
-            output = data - 'A';
-        else
-            return false;
-        return true;
+        output = decode_table[data];
+        return output != Kernel::invalid;
+    }
+
+    std::size_t encode_block(const byte* input, std::size_t size, byte* output) const override
+    {
+        const byte* begin = input;
+        const byte* end = input + size;
+
+#ifdef HTTPONY_BASE64_SIMD
+        // Reads 16 bytes to encode 12
+        for ( ; end - input >= 16; input += 12, output += 16 )
+            detail::base64_encode_simd(input, output, c62, c63);
+#endif
+
+        return input - begin + Kernel::encode(encode_table, input, end - input, output);
+    }
+
+    std::size_t decode_block(const byte* input, std::size_t size, byte* output) const override
+    {
+        const byte* begin = input;
+        const byte* end = input + size;
+
+#ifdef HTTPONY_BASE64_SIMD
+        // Writes 16 bytes to decode 12, the following groups leave enough room
+        for ( ; end - input >= 24; input += 16, output += 12 )
+            if ( !detail::base64_decode_simd(input, output, c62, c63) )
+                break;
+#endif
+
+        return input - begin + Kernel::decode(decode_table, input, end - input, output);
     }
 
     byte c62;
     byte c63;
+    byte encode_table[64];
+    byte decode_table[256];
+};
+
+/**
+ * \brief URL and file name safe variant of Base 64
+ * \see https://tools.ietf.org/html/rfc4648#section-5
+ */
+class Base64Url : public Base64
+{
+public:
+    /**
+     * \param pad Whether to ensure data is properly padded
+     */
+    explicit Base64Url(bool pad = false)
+        : Base64('-', '_', pad)
+    {}
 };
 
 /**
  * \brief Base 32 encoding
  * \see https://tools.ietf.org/html/rfc4648#section-6
  */
-class Base32 : public BaseBase
+class Base32 : public StaticBaseEncoding<detail::Base32Alphabet>
 {
 public:
     /**
      * \param pad Whether to ensure data is properly padded
      */
     explicit Base32(bool pad)
-        : BaseBase(8, 5, 5, 8, pad, '=', "Base 32")
+        : StaticBaseEncoding(pad, "Base 32")
     {}
 
     Base32() : Base32(true)
     {}
-
-
-private:
-    byte encode_group(byte data) const override
-    {
-        if ( data < 26 )
-            return 'A' + data;
-        return '2' + (data - 26);
-    }
-
-    bool decode_group(byte data, byte& output) const override
-    {
-        if ( data >= '2' && data <= '7' )
-            output = data - '2' + 26;
-        else if ( melanolib::string::ascii::is_lower(data) )
-            output = data - 'a';
-        else if ( melanolib::string::ascii::is_upper(data) )
-            output = data - 'A';
-        else
-            return false;
-        return true;
-    }
 };
 
 /**
  * \brief Base 32 hex encoding
  * \see https://tools.ietf.org/html/rfc4648#section-7
  */
-class Base32Hex : public BaseBase
+class Base32Hex : public StaticBaseEncoding<detail::Base32HexAlphabet>
 {
 public:
     /**
      * \param pad Whether to ensure data is properly padded
      */
     explicit Base32Hex(bool pad)
-        : BaseBase(8, 5, 5, 8, pad, '=', "Base 32 Hex")
+        : StaticBaseEncoding(pad, "Base 32 Hex")
     {}
 
     Base32Hex() : Base32Hex(true)
     {}
-
-private:
-    byte encode_group(byte data) const override
-    {
-        if ( data < 10 )
-            return '0' + data;
-        return 'A' + (data - 10);
-    }
-
-    bool decode_group(byte data, byte& output) const override
-    {
-        if ( melanolib::string::ascii::is_digit(data) )
-            output = data - '0';
-        else if ( melanolib::string::ascii::is_lower(data) && data <= 'v' )
-            output = data - 'a' + 10;
-        else if ( melanolib::string::ascii::is_upper(data) && data <= 'V' )
-            output = data - 'A' + 10;
-        else
-            return false;
-        return true;
-    }
 };
 
 /**
  * \brief Base 16 (hex) encoding
  * \see https://tools.ietf.org/html/rfc4648#section-8
  */
-class Base16 : public BaseBase
+class Base16 : public StaticBaseEncoding<detail::Base16Alphabet>
 {
 public:
     Base16()
-        : BaseBase(8, 1, 4, 2, true, '=', "Base 16")
+        : StaticBaseEncoding(true, "Base 16")
     {}
-
-private:
-    byte encode_group(byte data) const override
-    {
-        return melanolib::string::ascii::hex_digit(data);
-    }
-
-    bool decode_group(byte data, byte& output) const override
-    {
-        if ( melanolib::string::ascii::is_xdigit(data) )
-        {
-            output = melanolib::string::ascii::get_hex(data);
-            return true;
-        }
-        return false;
-    }
 };
 
 } // namespace httpony
@@ -0,0 +1,337 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTPONY_BASE_ENCODING_STREAM_HPP
+#define HTTPONY_BASE_ENCODING_STREAM_HPP
+
+/// \cond
+#include <algorithm>
+#include <cstring>
+#include <streambuf>
+/// \endcond
+
+#include "httpony/base_encoding.hpp"
+
+namespace httpony {
+
+/**
+ * \brief Encodes data fed in arbitrary chunks
+ *
+ * Bytes which don't make up a whole group are kept until the next call
+ * to feed() or finish().
+ * \tparam Encoding A class derived from BaseBase
+ */
+template<class Encoding>
+    class BaseEncoder
+{
+public:
+    explicit BaseEncoder(Encoding encoding = Encoding())
+        : encoding(std::move(encoding))
+    {}
+
+    /**
+     * \brief Encodes \p size bytes from \p data appending the result to \p output
+     */
+    void feed(const char* data, std::size_t size, std::string& output)
+    {
+        std::size_t group = encoding.unencoded_group_size();
+
+        if ( !pending.empty() )
+        {
+            std::size_t missing = std::min(group - pending.size(), size);
+            pending.append(data, missing);
+            data += missing;
+            size -= missing;
+            if ( pending.size() < group )
+                return;
+            encoding.encode_append(view(pending.data(), pending.size()), output);
+            pending.clear();
+        }
+
+        std::size_t whole = size - size % group;
+        encoding.encode_append(view(data, whole), output);
+        pending.assign(data + whole, size - whole);
+    }
+
+    void feed(const std::string& data, std::string& output)
+    {
+        feed(data.data(), data.size(), output);
+    }
+
+    /**
+     * \brief Encodes the remaining partial group, adding padding if needed
+     */
+    void finish(std::string& output)
+    {
+        encoding.encode_append(view(pending.data(), pending.size()), output);
+        pending.clear();
+    }
+
+    const Encoding& base_encoding() const
+    {
+        return encoding;
+    }
+
+private:
+    static byte_view view(const char* data, std::size_t size)
+    {
+        return byte_view(reinterpret_cast<const byte*>(data), size);
+    }
+
+    Encoding encoding;
+    std::string pending;
+};
+
+/**
+ * \brief Decodes data fed in arbitrary chunks
+ *
+ * Characters which don't make up a whole group are kept until the next
+ * call to feed() or finish().
+ * \tparam Encoding A class derived from BaseBase
+ */
+template<class Encoding>
+    class BaseDecoder
+{
+public:
+    explicit BaseDecoder(Encoding encoding = Encoding())
+        : encoding(std::move(encoding))
+    {}
+
+    /**
+     * \brief Decodes \p size characters from \p data appending the result to \p output
+     * \throws EncodingError if the data is not valid
+     */
+    void feed(const char* data, std::size_t size, std::string& output)
+    {
+        if ( !size )
+            return;
+
+        if ( padded )
+            error();
+
+        std::size_t group = encoding.encoded_group_size();
+
+        if ( !pending.empty() )
+        {
+            std::size_t missing = std::min(group - pending.size(), size);
+            pending.append(data, missing);
+            data += missing;
+            size -= missing;
+            if ( pending.size() < group )
+                return;
+            decode(pending.data(), pending.size(), output);
+            pending.clear();
+            if ( padded && size )
+                error();
+        }
+
+        std::size_t whole = size - size % group;
+        decode(data, whole, output);
+        pending.assign(data + whole, size - whole);
+        if ( padded && !pending.empty() )
+            error();
+    }
+
+    void feed(const std::string& data, std::string& output)
+    {
+        feed(data.data(), data.size(), output);
+    }
+
+    /**
+     * \brief Decodes the remaining partial group
+     * \throws EncodingError if the data is truncated
+     */
+    void finish(std::string& output)
+    {
+        if ( !pending.empty() )
+        {
+            decode(pending.data(), pending.size(), output);
+            pending.clear();
+        }
+        padded = false;
+    }
+
+    const Encoding& base_encoding() const
+    {
+        return encoding;
+    }
+
+private:
+    void decode(const char* data, std::size_t size, std::string& output)
+    {
+        if ( !size )
+            return;
+
+        if ( !encoding.decode_append(byte_view(reinterpret_cast<const byte*>(data), size), output) )
+            error();
+
+        // Padding can only be in the last group, anything after it is invalid
+        std::size_t group = std::min(size, encoding.encoded_group_size());
+        if ( std::memchr(data + size - group, encoding.padding_character(), group) )
+            padded = true;
+    }
+
+    void error /*[[noreturn]]*/ () const
+    {
+        throw EncodingError("Invalid " + encoding.name() + " string");
+    }
+
+    Encoding encoding;
+    std::string pending;
+    bool padded = false;
+};
+
+/**
+ * \brief Output stream buffer which encodes the data written into it
+ * and forwards the result to another stream buffer
+ *
+ * The last partial group is written by finish() or by the destructor.
+ */
+template<class Encoding>
+    class BaseEncoderBuffer : public std::streambuf
+{
+public:
+    explicit BaseEncoderBuffer(std::streambuf* target, Encoding encoding = Encoding())
+        : target(target),
+          encoder(std::move(encoding))
+    {
+        setp(buffer, buffer + sizeof(buffer));
+    }
+
+    ~BaseEncoderBuffer()
+    {
+        finish();
+    }
+
+    /**
+     * \brief Writes all pending data, including the final padding
+     * \return \b false if the target didn't accept all the data
+     */
+    bool finish()
+    {
+        if ( finished )
+            return true;
+        finished = true;
+        bool ok = encode();
+        setp(nullptr, nullptr);
+        if ( !ok )
+            return false;
+        encoded.clear();
+        encoder.finish(encoded);
+        return write_encoded();
+    }
+
+protected:
+    int_type overflow(int_type ch) override
+    {
+        if ( finished || !encode() )
+            return traits_type::eof();
+        if ( !traits_type::eq_int_type(ch, traits_type::eof()) )
+        {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    int sync() override
+    {
+        if ( !encode() )
+            return -1;
+        return target->pubsync();
+    }
+
+private:
+    /**
+     * \brief Encodes the put area
+     */
+    bool encode()
+    {
+        encoded.clear();
+        encoder.feed(pbase(), pptr() - pbase(), encoded);
+        setp(buffer, buffer + sizeof(buffer));
+        return write_encoded();
+    }
+
+    bool write_encoded()
+    {
+        return target->sputn(encoded.data(), encoded.size()) == std::streamsize(encoded.size());
+    }
+
+    std::streambuf* target;
+    BaseEncoder<Encoding> encoder;
+    char buffer[4096];
+    std::string encoded;
+    bool finished = false;
+};
+
+/**
+ * \brief Input stream buffer which decodes the data read from another
+ * stream buffer
+ *
+ * Invalid input causes an EncodingError when reading, which input streams
+ * report by setting the badbit.
+ */
+template<class Encoding>
+    class BaseDecoderBuffer : public std::streambuf
+{
+public:
+    explicit BaseDecoderBuffer(std::streambuf* source, Encoding encoding = Encoding())
+        : source(source),
+          decoder(std::move(encoding))
+    {}
+
+protected:
+    int_type underflow() override
+    {
+        while ( gptr() == egptr() )
+        {
+            if ( finished )
+                return traits_type::eof();
+
+            decoded.clear();
+            std::streamsize size = source->sgetn(buffer, sizeof(buffer));
+            if ( size > 0 )
+            {
+                decoder.feed(buffer, size, decoded);
+            }
+            else
+            {
+                finished = true;
+                decoder.finish(decoded);
+            }
+
+            char* begin = &decoded[0];
+            setg(begin, begin, begin + decoded.size());
+        }
+        return traits_type::to_int_type(*gptr());
+    }
+
+private:
+    std::streambuf* source;
+    BaseDecoder<Encoding> decoder;
+    char buffer[4096];
+    std::string decoded;
+    bool finished = false;
+};
+
+} // namespace httpony
+#endif // HTTPONY_BASE_ENCODING_STREAM_HPP
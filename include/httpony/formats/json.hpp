@@ -22,6 +22,8 @@
 #define HTTPONY_JSON_HPP
 
 /// \cond
+#include <cerrno>
+#include <cstdlib>
 #include <fstream>
 #include <istream>
 #include <stack>
@@ -29,6 +31,8 @@
 #include <string>
 #include <iomanip>
 #include <list>
+#include <unordered_map>
+#include <vector>
 
 #include <boost/property_tree/ptree.hpp>
 
@@ -36,6 +40,8 @@
 #include <melanolib/string/encoding.hpp>
 /// \endcond
 
+#include "httpony/util/number_format.hpp"
+
 namespace httpony {
 namespace json {
 
@@ -122,6 +128,128 @@ namespace detail {
 
     template<class T> void tree_node_to_array(T& node){}
 
+    /**
+     * \brief Checks the number grammar from RFC 7159
+     */
+    inline bool valid_number(const std::string& token)
+    {
+        using melanolib::string::ascii::is_digit;
+        std::size_t i = 0;
+        std::size_t size = token.size();
+
+        if ( i < size && token[i] == '-' )
+            i++;
+
+        if ( i >= size || !is_digit(token[i]) )
+            return false;
+        if ( token[i] == '0' )
+            i++;
+        else
+            while ( i < size && is_digit(token[i]) )
+                i++;
+
+        if ( i < size && token[i] == '.' )
+        {
+            i++;
+            if ( i >= size || !is_digit(token[i]) )
+                return false;
+            while ( i < size && is_digit(token[i]) )
+                i++;
+        }
+
+        if ( i < size && (token[i] == 'e' || token[i] == 'E') )
+        {
+            i++;
+            if ( i < size && (token[i] == '+' || token[i] == '-') )
+                i++;
+            if ( i >= size || !is_digit(token[i]) )
+                return false;
+            while ( i < size && is_digit(token[i]) )
+                i++;
+        }
+
+        return i == size;
+    }
+
+    /**
+     * \brief Whether \p c can appear unescaped in a string literal
+     */
+    constexpr inline bool raw_string_char(unsigned char c)
+    {
+        return c >= 0x20 && c != '"' && c != '\\';
+    }
+
+    /**
+     * \brief Reads the 4 hex digits of a \c \\u escape into \p point
+     */
+    template<class Next>
+        bool read_uniescape(Next& next, uint32_t& point)
+    {
+        point = 0;
+        for ( int i = 0; i < 4; i++ )
+        {
+            int c = next();
+            if ( c < 0 || !melanolib::string::ascii::is_xdigit(c) )
+                return false;
+            point = (point << 4) | melanolib::string::ascii::get_hex(c);
+        }
+        return true;
+    }
+
+    /**
+     * \brief Decodes an escape sequence of a strict JSON string literal
+     *
+     * Surrogates must come in pairs of consecutive \c \\u escapes.
+     * \param next     Functor returning the next character as unsigned,
+     *                 or a negative value at the end of the input
+     * \param output   String the decoded character is appended to
+     * \returns \b nullptr on success, otherwise a description of the error
+     * \pre The backslash has already been read
+     */
+    template<class Next>
+        const char* unescape(Next&& next, std::string& output)
+    {
+        using melanolib::string::Utf8Parser;
+
+        int c = next();
+        switch ( c )
+        {
+            case '"': case '\\': case '/':
+                output += char(c);
+                return nullptr;
+            case 'b': output += '\b'; return nullptr;
+            case 'f': output += '\f'; return nullptr;
+            case 'r': output += '\r'; return nullptr;
+            case 't': output += '\t'; return nullptr;
+            case 'n': output += '\n'; return nullptr;
+            case 'u': break;
+            default:
+                return c < 0 ? "Unterminated string" : "Invalid escape sequence";
+        }
+
+        uint32_t point;
+        if ( !read_uniescape(next, point) )
+            return "Invalid unicode escape";
+
+        if ( Utf8Parser::is_low_surrogate(point) )
+            return "Unpaired surrogate";
+
+        if ( Utf8Parser::is_high_surrogate(point) )
+        {
+            uint32_t low;
+            if ( next() != '\\' || next() != 'u' )
+                return "Unpaired surrogate";
+            if ( !read_uniescape(next, low) )
+                return "Invalid unicode escape";
+            if ( !Utf8Parser::is_low_surrogate(low) )
+                return "Unpaired surrogate";
+            point = Utf8Parser::combine_surrogates(point, low);
+        }
+
+        output += Utf8Parser::encode(point);
+        return nullptr;
+    }
+
 } // namespace detail
 
 /**
@@ -140,6 +268,68 @@ struct JsonError : public std::runtime_error
 };
 
 
+/**
+ * \brief Pre-split path for JsonNode accessors
+ *
+ * Accessors taking a path string convert it to a JsonPath on each call,
+ * paths used repeatedly can be constructed once and reused.
+ */
+class JsonPath
+{
+public:
+    using segment_list = std::vector<std::string>;
+
+    JsonPath() = default;
+
+    JsonPath(const std::string& path)
+        : segments_(melanolib::string::char_split(path, '.'))
+    {}
+
+    JsonPath(const char* path)
+        : JsonPath(std::string(path))
+    {}
+
+    explicit JsonPath(segment_list segments)
+        : segments_(std::move(segments))
+    {}
+
+    const segment_list& segments() const
+    {
+        return segments_;
+    }
+
+    bool empty() const
+    {
+        return segments_.empty();
+    }
+
+    std::size_t size() const
+    {
+        return segments_.size();
+    }
+
+    /**
+     * \brief Path in the dotted string format
+     */
+    std::string str() const
+    {
+        return melanolib::string::implode(".", segments_);
+    }
+
+    bool operator==(const JsonPath& other) const
+    {
+        return segments_ == other.segments_;
+    }
+
+    bool operator!=(const JsonPath& other) const
+    {
+        return segments_ != other.segments_;
+    }
+
+private:
+    segment_list segments_;
+};
+
 class JsonNode
 {
 public:
@@ -164,11 +354,11 @@ public:
     explicit JsonNode(std::nullptr_t) : type_(Null) {}
     explicit JsonNode(long value)
       : type_(Number),
-        value_(melanolib::string::to_string(value))
+        value_(number::to_string((long long)value))
     {}
     explicit JsonNode(double value)
       : type_(Number),
-        value_(melanolib::string::to_string(value))
+        value_(number::to_string(value))
     {}
     explicit JsonNode(int value) : JsonNode(long(value)){}
     explicit JsonNode(bool value)
@@ -260,7 +450,7 @@ public:
     void set_value_bool(long value)
     {
         type_ = Number;
-        value_ = melanolib::string::to_string(value);
+        value_ = number::to_string((long long)value);
     }
 
     bool value_bool() const
@@ -380,7 +570,7 @@ public:
         return iter->second;
     }
 
-    std::string get_raw(const path_type& path, const std::string& default_value) const
+    std::string get_raw(const JsonPath& path, const std::string& default_value) const
     {
         try {
             return get_child(path).raw_value();
@@ -436,7 +626,7 @@ public:
         return count;
     }
 
-    JsonNode& get_child(const path_type& path)
+    JsonNode& get_child(const JsonPath& path)
     {
         const JsonNode* child = find_child_ptr(path);
         if ( !child )
@@ -444,7 +634,7 @@ public:
         return const_cast<JsonNode&>(*child);
     }
 
-    const JsonNode& get_child(const path_type& path) const
+    const JsonNode& get_child(const JsonPath& path) const
     {
         const JsonNode* child = find_child_ptr(path);
         if ( !child )
@@ -452,7 +642,7 @@ public:
         return *child;
     }
 
-    JsonNode& get_child(const path_type& path, JsonNode& default_child)
+    JsonNode& get_child(const JsonPath& path, JsonNode& default_child)
     {
         const JsonNode* child = find_child_ptr(path);
         if ( !child )
@@ -460,7 +650,7 @@ public:
         return const_cast<JsonNode&>(*child);
     }
 
-    const JsonNode& get_child(const path_type& path, const JsonNode& default_child) const
+    const JsonNode& get_child(const JsonPath& path, const JsonNode& default_child) const
     {
         const JsonNode* child = find_child_ptr(path);
         if ( !child )
@@ -468,7 +658,7 @@ public:
         return *child;
     }
 
-    melanolib::Optional<JsonNode&> get_child_optional(const path_type& path)
+    melanolib::Optional<JsonNode&> get_child_optional(const JsonPath& path)
     {
         const JsonNode* child = find_child_ptr(path);
         if ( !child )
@@ -476,7 +666,7 @@ public:
         return const_cast<JsonNode&>(*child);
     }
 
-    melanolib::Optional<const JsonNode&> get_child_optional(const path_type& path) const
+    melanolib::Optional<const JsonNode&> get_child_optional(const JsonPath& path) const
     {
         const JsonNode* child = find_child_ptr(path);
         if ( !child )
@@ -484,7 +674,7 @@ public:
         return *child;
     }
 
-    JsonNode& add_child(const path_type& path, JsonNode node = {})
+    JsonNode& add_child(const JsonPath& path, JsonNode node = {})
     {
         JsonNode* parent;
         std::string last;
@@ -493,7 +683,7 @@ public:
         return parent->children_.back().second;
     }
 
-    JsonNode& put_child(const path_type& path, JsonNode node = {})
+    JsonNode& put_child(const JsonPath& path, JsonNode node = {})
     {
         JsonNode* parent;
         std::string last;
@@ -512,7 +702,7 @@ public:
     }
 
     template<class T>
-    JsonNode& put(const path_type& path, T&& value)
+    JsonNode& put(const JsonPath& path, T&& value)
     {
         return put_child(path, JsonNode(std::forward<T>(value)));
     }
@@ -592,13 +782,13 @@ public:
 
 
     template<class Type>
-    auto get(const path_type& path) const -> decltype(get_value<Type>())
+    auto get(const JsonPath& path) const -> decltype(get_value<Type>())
     {
         return get_child(path).get_value<Type>();
     }
 
     template<class Type>
-    auto get(const path_type& path, Type&& default_value) const -> decltype(get_value<Type>())
+    auto get(const JsonPath& path, Type&& default_value) const -> decltype(get_value<Type>())
     {
         try {
             return get_child(path).get_value<Type>();
@@ -608,7 +798,7 @@ public:
     }
 
     template<class Type>
-    auto get_optional(const path_type& path) const -> melanolib::Optional<decltype(get_value<Type>())>
+    auto get_optional(const JsonPath& path) const -> melanolib::Optional<decltype(get_value<Type>())>
     {
         try {
             return get_child(path).get_value<Type>();
@@ -618,11 +808,10 @@ public:
     }
 
 private:
-    const JsonNode* find_child_ptr(const path_type& path) const
+    const JsonNode* find_child_ptr(const JsonPath& path) const
     {
-        auto pieces = melanolib::string::char_split(path, '.');
         const JsonNode* parent = this;
-        for ( const auto& piece : pieces )
+        for ( const auto& piece : path.segments() )
         {
             auto iter = parent->find(piece);
             if ( iter == parent->children_.end() )
@@ -632,23 +821,21 @@ private:
         return parent;
     }
 
-    std::pair<JsonNode*, std::string> add_parent(const path_type& path)
+    std::pair<JsonNode*, std::string> add_parent(const JsonPath& path)
     {
-        auto pieces = melanolib::string::char_split(path, '.');
-        if ( pieces.size() < 1 )
+        const auto& pieces = path.segments();
+        if ( pieces.empty() )
             throw JsonError("", 0, "Missing path");
 
-        auto last = pieces.back();
-        pieces.pop_back();
         JsonNode* parent = this;
-        for ( const auto& piece : pieces )
+        for ( auto iter = pieces.begin(), last = pieces.end() - 1; iter != last; ++iter )
         {
-            parent = &(*parent)[piece];
+            parent = &(*parent)[*iter];
             if ( parent->type_ != Object && parent->type_ != Array )
                 throw JsonError("", 0, "Not an object");
         }
 
-        return {parent, last};
+        return {parent, pieces.back()};
     }
 
 private:
@@ -664,6 +851,267 @@ namespace detail{
     }
 } // namespace detail
 
+/**
+ * \brief Set of paths which can be resolved in a single traversal
+ *
+ * The paths are merged in a prefix tree indexed by key, so resolving
+ * them visits each child of the document at most once instead of walking
+ * it again for every path.
+ */
+class JsonPathSet
+{
+public:
+    JsonPathSet()
+        : trie(1)
+    {}
+
+    JsonPathSet(std::initializer_list<JsonPath> paths)
+        : JsonPathSet()
+    {
+        for ( const auto& path : paths )
+            add(path);
+    }
+
+    explicit JsonPathSet(const std::vector<JsonPath>& paths)
+        : JsonPathSet()
+    {
+        for ( const auto& path : paths )
+            add(path);
+    }
+
+    /**
+     * \brief Adds a path
+     * \returns The index of the path in the results of resolve()
+     */
+    std::size_t add(const JsonPath& path)
+    {
+        std::size_t node = 0;
+        for ( const auto& segment : path.segments() )
+        {
+            auto iter = trie[node].children.find(segment);
+            if ( iter == trie[node].children.end() )
+            {
+                std::size_t child = trie.size();
+                trie[node].children.emplace(segment, child);
+                trie.emplace_back();
+                node = child;
+            }
+            else
+            {
+                node = iter->second;
+            }
+        }
+        trie[node].targets.push_back(path_count);
+        return path_count++;
+    }
+
+    /**
+     * \brief Number of paths in the set
+     */
+    std::size_t size() const
+    {
+        return path_count;
+    }
+
+    /**
+     * \brief Finds all the paths in \p root
+     * \returns A vector with the node for each path in the order they
+     *          were added, \b nullptr for paths not found
+     */
+    std::vector<const JsonNode*> resolve(const JsonNode& root) const
+    {
+        std::vector<const JsonNode*> result(path_count, nullptr);
+        std::vector<bool> matched(trie.size(), false);
+        resolve(root, 0, result, matched);
+        return result;
+    }
+
+private:
+    struct TrieNode
+    {
+        /// Maps keys to indices in trie
+        std::unordered_map<std::string, std::size_t> children;
+        /// Indices of the paths ending on this node
+        std::vector<std::size_t> targets;
+    };
+
+    void resolve(const JsonNode& json, std::size_t node,
+                 std::vector<const JsonNode*>& result,
+                 std::vector<bool>& matched) const
+    {
+        for ( auto target : trie[node].targets )
+            result[target] = &json;
+
+        const auto& children = trie[node].children;
+        std::size_t remaining = children.size();
+        for ( auto iter = json.begin(); remaining && iter != json.end(); ++iter )
+        {
+            auto found = children.find(iter->first);
+            // Like JsonNode::find, only the first child with a given key is used
+            if ( found == children.end() || matched[found->second] )
+                continue;
+            matched[found->second] = true;
+            remaining--;
+            resolve(iter->second, found->second, result, matched);
+        }
+    }
+
+    std::vector<TrieNode> trie;
+    std::size_t path_count = 0;
+};
+
+/**
+ * \brief Base class for objects receiving JSON parsing events
+ *
+ * Parsers taking a handler call these as templates so derived classes
+ * only need to hide the functions they are interested in.
+ * Returning \b false from any of them stops the parser.
+ */
+struct JsonHandler
+{
+    bool start_object() { return true; }
+    bool end_object() { return true; }
+    bool start_array() { return true; }
+    bool end_array() { return true; }
+    bool key(const std::string& name) { return true; }
+    bool string(const std::string& value) { return true; }
+    /**
+     * \param raw Number as it appears in the source
+     */
+    bool number(const std::string& raw) { return true; }
+    bool boolean(bool value) { return true; }
+    bool null() { return true; }
+};
+
+/**
+ * \brief Handler that builds a JsonNode from parsing events
+ */
+class JsonTreeBuilder : public JsonHandler
+{
+public:
+    bool start_object()
+    {
+        return open(JsonNode());
+    }
+
+    bool end_object()
+    {
+        return close();
+    }
+
+    bool start_array()
+    {
+        JsonNode node;
+        node.to_array();
+        return open(std::move(node));
+    }
+
+    bool end_array()
+    {
+        return close();
+    }
+
+    bool key(const std::string& name)
+    {
+        pending_key = name;
+        return true;
+    }
+
+    bool string(const std::string& value)
+    {
+        return add(JsonNode(value));
+    }
+
+    bool number(const std::string& raw)
+    {
+        if ( raw.find_first_of(".eE") == std::string::npos )
+        {
+            errno = 0;
+            long value = std::strtol(raw.c_str(), nullptr, 10);
+            if ( errno != ERANGE )
+                return add(JsonNode(value));
+        }
+        return add(JsonNode(std::strtod(raw.c_str(), nullptr)));
+    }
+
+    bool boolean(bool value)
+    {
+        return add(JsonNode(value));
+    }
+
+    bool null()
+    {
+        return add(JsonNode(nullptr));
+    }
+
+    /**
+     * \brief Resets the builder to an empty object
+     */
+    void clear()
+    {
+        root.clear();
+        stack.clear();
+        pending_key.clear();
+    }
+
+    /**
+     * \brief Tree built so far
+     */
+    JsonNode& tree()
+    {
+        return root;
+    }
+
+    const JsonNode& tree() const
+    {
+        return root;
+    }
+
+private:
+    bool add(JsonNode&& node)
+    {
+        if ( stack.empty() )
+        {
+            root = std::move(node);
+            return true;
+        }
+
+        JsonNode* parent = stack.back();
+        if ( parent->type() == JsonNode::Array )
+            parent->push_back({std::to_string(parent->size()), std::move(node)});
+        else
+            parent->push_back({std::move(pending_key), std::move(node)});
+        return true;
+    }
+
+    bool open(JsonNode&& node)
+    {
+        if ( stack.empty() )
+        {
+            root = std::move(node);
+            stack.push_back(&root);
+        }
+        else
+        {
+            add(std::move(node));
+            stack.push_back(&stack.back()->back().second);
+        }
+        return true;
+    }
+
+    bool close()
+    {
+        if ( stack.empty() )
+            return false;
+        stack.pop_back();
+        return true;
+    }
+
+    JsonNode root;
+    std::vector<JsonNode*> stack;
+    std::string pending_key;
+};
+
 /**
  * \brief Class that populates a property tree from a JSON in a stream
  *
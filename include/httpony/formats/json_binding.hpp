@@ -0,0 +1,354 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef HTTPONY_JSON_BINDING_HPP
+#define HTTPONY_JSON_BINDING_HPP
+
+/// \cond
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <melanolib/utils/c++-compat.hpp>
+/// \endcond
+
+#include "httpony/formats/json_stream.hpp"
+#include "httpony/formats/json_writer.hpp"
+
+namespace httpony {
+namespace json {
+
+/**
+ * \brief Describes how a class maps to a JSON object
+ *
+ * Specializations must have a static function \c fields() returning a
+ * tuple of field() objects, the easiest way to define them is with
+ * HTTPONY_JSON_BINDING.
+ */
+template<class T>
+    struct Binding
+{
+};
+
+/**
+ * \brief Binds a JSON key to a data member
+ */
+template<class Class, class Member>
+    struct Field
+{
+    const char* name;
+    std::size_t name_size;
+    Member Class::* member;
+};
+
+template<class Class, class Member, std::size_t Size>
+    constexpr Field<Class, Member> field(const char (&name)[Size], Member Class::* member)
+{
+    return {name, Size - 1, member};
+}
+
+namespace detail {
+
+    template<class T, class = void>
+        struct has_binding : std::false_type {};
+
+    template<class T>
+        struct has_binding<T, decltype((void)Binding<T>::fields())> : std::true_type {};
+
+    template<class Tuple, class Functor, std::size_t... Indices>
+        void for_each_field(const Tuple& tuple, Functor&& functor, std::index_sequence<Indices...>)
+    {
+        using swallow = int[];
+        (void)swallow{0, (functor(std::get<Indices>(tuple)), 0)...};
+    }
+
+    /**
+     * \brief Calls \p functor on each element of \p tuple
+     */
+    template<class... Fields, class Functor>
+        void for_each_field(const std::tuple<Fields...>& tuple, Functor&& functor)
+    {
+        for_each_field(tuple, std::forward<Functor>(functor), std::index_sequence_for<Fields...>());
+    }
+
+    inline void expect(JsonReader& reader, bool condition, const char* message)
+    {
+        if ( !condition )
+            reader.error(message);
+    }
+
+} // namespace detail
+
+/**
+ * \brief Writes a bound object
+ */
+template<class T>
+    std::enable_if_t<detail::has_binding<T>::value>
+    write_json(JsonWriter& writer, const T& object)
+{
+    writer.start_object();
+    detail::for_each_field(Binding<T>::fields(), [&writer, &object](const auto& field) {
+        writer.key(field.name, field.name_size);
+        write_json(writer, object.*field.member);
+    });
+    writer.end_object();
+}
+
+template<class T>
+    std::enable_if_t<std::is_arithmetic<T>::value>
+    write_json(JsonWriter& writer, T value)
+{
+    writer.value(value);
+}
+
+inline void write_json(JsonWriter& writer, const std::string& value)
+{
+    writer.string(value);
+}
+
+inline void write_json(JsonWriter& writer, const JsonNode& value)
+{
+    writer.value(value);
+}
+
+template<class T>
+    void write_json(JsonWriter& writer, const std::vector<T>& array)
+{
+    writer.start_array();
+    for ( const auto& item : array )
+        write_json(writer, item);
+    writer.end_array();
+}
+
+template<class T>
+    void write_json(JsonWriter& writer, const std::map<std::string, T>& map)
+{
+    writer.start_object();
+    for ( const auto& pair : map )
+    {
+        writer.key(pair.first);
+        write_json(writer, pair.second);
+    }
+    writer.end_object();
+}
+
+template<class T>
+    void write_json(JsonWriter& writer, const melanolib::Optional<T>& value)
+{
+    if ( value )
+        write_json(writer, *value);
+    else
+        writer.null();
+}
+
+/**
+ * \brief Reads a bound object
+ * \pre The last event from \p reader is the start of the value
+ * \throws JsonError if the value doesn't match the binding
+ *
+ * Unknown keys are skipped, missing ones leave the members untouched.
+ */
+template<class T>
+    std::enable_if_t<detail::has_binding<T>::value>
+    read_json(JsonReader& reader, T& object)
+{
+    detail::expect(reader, reader.event() == JsonReader::Event::StartObject, "Expected object");
+    const auto fields = Binding<T>::fields();
+    while ( reader.next() == JsonReader::Event::Key )
+    {
+        const std::string& key = reader.value();
+        bool found = false;
+        detail::for_each_field(fields, [&](const auto& field) {
+            if ( !found && key.size() == field.name_size &&
+                 std::memcmp(key.data(), field.name, field.name_size) == 0 )
+            {
+                found = true;
+                reader.next();
+                read_json(reader, object.*field.member);
+            }
+        });
+        if ( !found )
+        {
+            reader.next();
+            reader.skip();
+        }
+    }
+}
+
+inline void read_json(JsonReader& reader, bool& value)
+{
+    detail::expect(reader, reader.event() == JsonReader::Event::Boolean, "Expected boolean");
+    value = reader.value() == "true";
+}
+
+template<class T>
+    std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value>
+    read_json(JsonReader& reader, T& value)
+{
+    detail::expect(reader, reader.event() == JsonReader::Event::Number &&
+        reader.value().find_first_of(".eE") == std::string::npos, "Expected integer");
+    errno = 0;
+    if ( std::is_signed<T>::value )
+    {
+        long long result = std::strtoll(reader.value().c_str(), nullptr, 10);
+        detail::expect(reader, errno != ERANGE &&
+            result >= (long long)std::numeric_limits<T>::min() &&
+            result <= (long long)std::numeric_limits<T>::max(), "Integer out of range");
+        value = T(result);
+    }
+    else
+    {
+        unsigned long long result = std::strtoull(reader.value().c_str(), nullptr, 10);
+        detail::expect(reader, errno != ERANGE && reader.value()[0] != '-' &&
+            result <= (unsigned long long)std::numeric_limits<T>::max(), "Integer out of range");
+        value = T(result);
+    }
+}
+
+template<class T>
+    std::enable_if_t<std::is_floating_point<T>::value>
+    read_json(JsonReader& reader, T& value)
+{
+    detail::expect(reader, reader.event() == JsonReader::Event::Number, "Expected number");
+    value = T(std::strtod(reader.value().c_str(), nullptr));
+}
+
+inline void read_json(JsonReader& reader, std::string& value)
+{
+    detail::expect(reader, reader.event() == JsonReader::Event::String, "Expected string");
+    value = reader.value();
+}
+
+inline void read_json(JsonReader& reader, JsonNode& value)
+{
+    value = reader.read_node();
+}
+
+template<class T>
+    void read_json(JsonReader& reader, std::vector<T>& array)
+{
+    detail::expect(reader, reader.event() == JsonReader::Event::StartArray, "Expected array");
+    array.clear();
+    while ( reader.next() != JsonReader::Event::EndArray )
+    {
+        array.emplace_back();
+        read_json(reader, array.back());
+    }
+}
+
+template<class T>
+    void read_json(JsonReader& reader, std::map<std::string, T>& map)
+{
+    detail::expect(reader, reader.event() == JsonReader::Event::StartObject, "Expected object");
+    map.clear();
+    while ( reader.next() == JsonReader::Event::Key )
+    {
+        T& item = map[reader.value()];
+        reader.next();
+        read_json(reader, item);
+    }
+}
+
+template<class T>
+    void read_json(JsonReader& reader, melanolib::Optional<T>& value)
+{
+    if ( reader.event() == JsonReader::Event::Null )
+    {
+        value = {};
+        return;
+    }
+    T item;
+    read_json(reader, item);
+    value = std::move(item);
+}
+
+/**
+ * \brief Serializes \p object to a string
+ */
+template<class T>
+    std::string to_json(const T& object, int indent = 0)
+{
+    std::string result;
+    JsonWriter writer(result, indent);
+    write_json(writer, object);
+    writer.flush();
+    return result;
+}
+
+/**
+ * \brief Deserializes a whole document from \p input
+ * \throws JsonError On bad syntax or if the value doesn't match \p T
+ */
+template<class T>
+    T from_json(std::istream& input, const std::string& stream_name = "")
+{
+    JsonReader reader(input, stream_name);
+    T object;
+    reader.next();
+    read_json(reader, object);
+    reader.next();
+    return object;
+}
+
+template<class T>
+    T from_json(const std::string& json)
+{
+    std::istringstream input(json);
+    return from_json<T>(input);
+}
+
+} // namespace json
+} // namespace httpony
+
+/**
+ * \brief Binds a data member to a JSON key with the same name,
+ * to be used inside HTTPONY_JSON_BINDING
+ */
+#define HTTPONY_JSON_FIELD(member) \
+    ::httpony::json::field(#member, &bound_type::member)
+
+/**
+ * \brief Defines httpony::json::Binding for \p type
+ *
+ * Must be used in the global namespace, the remaining arguments are
+ * HTTPONY_JSON_FIELD() or httpony::json::field() expressions:
+ * \code
+ * HTTPONY_JSON_BINDING(app::Point,
+ *     HTTPONY_JSON_FIELD(x),
+ *     httpony::json::field("why", &app::Point::y)
+ * )
+ * \endcode
+ */
+#define HTTPONY_JSON_BINDING(type, ...) \
+    namespace httpony { namespace json { \
+    template<> struct Binding<type> { \
+        using bound_type = type; \
+        static auto fields() { return std::make_tuple(__VA_ARGS__); } \
+    }; \
+    }}
+
+#endif // HTTPONY_JSON_BINDING_HPP
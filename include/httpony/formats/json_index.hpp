@@ -0,0 +1,651 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef HTTPONY_JSON_INDEX_HPP
+#define HTTPONY_JSON_INDEX_HPP
+
+/// \cond
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#if defined(__AVX2__)
+#   include <immintrin.h>
+#elif defined(__SSE2__)
+#   include <emmintrin.h>
+#endif
+/// \endcond
+
+#include "httpony/formats/json.hpp"
+
+namespace httpony {
+namespace json {
+
+namespace detail {
+
+    /**
+     * \brief Bit masks for a block of 64 input characters
+     *
+     * Bit \c n of each mask refers to the \c n-th character of the block
+     */
+    struct BlockMasks
+    {
+        uint64_t backslash = 0;     ///< '\\'
+        uint64_t quote = 0;         ///< '"'
+        uint64_t operators = 0;     ///< '{', '}', '[', ']', ':', ','
+        uint64_t whitespace = 0;    ///< ' ', '\\t', '\\n', '\\r'
+    };
+
+    constexpr std::size_t index_block_size = 64;
+
+    /**
+     * \brief Classifies a block character by character
+     */
+    inline BlockMasks scan_block_scalar(const char* block)
+    {
+        BlockMasks masks;
+        for ( std::size_t i = 0; i < index_block_size; i++ )
+        {
+            uint64_t bit = uint64_t(1) << i;
+            switch ( block[i] )
+            {
+                case '\\':
+                    masks.backslash |= bit;
+                    break;
+                case '"':
+                    masks.quote |= bit;
+                    break;
+                case '{': case '}': case '[': case ']': case ':': case ',':
+                    masks.operators |= bit;
+                    break;
+                case ' ': case '\t': case '\n': case '\r':
+                    masks.whitespace |= bit;
+                    break;
+            }
+        }
+        return masks;
+    }
+
+#if defined(__AVX2__)
+    inline uint64_t simd_eq(__m256i lo, __m256i hi, char c)
+    {
+        __m256i chr = _mm256_set1_epi8(c);
+        uint64_t mlo = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, chr)));
+        uint64_t mhi = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, chr)));
+        return mlo | (mhi << 32);
+    }
+
+    /**
+     * \brief Classifies a block 32 characters at a time
+     */
+    inline BlockMasks scan_block_simd(const char* block)
+    {
+        __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+        __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+        BlockMasks masks;
+        masks.backslash = simd_eq(lo, hi, '\\');
+        masks.quote = simd_eq(lo, hi, '"');
+        masks.operators = simd_eq(lo, hi, '{') | simd_eq(lo, hi, '}') |
+                          simd_eq(lo, hi, '[') | simd_eq(lo, hi, ']') |
+                          simd_eq(lo, hi, ':') | simd_eq(lo, hi, ',');
+        masks.whitespace = simd_eq(lo, hi, ' ') | simd_eq(lo, hi, '\t') |
+                           simd_eq(lo, hi, '\n') | simd_eq(lo, hi, '\r');
+        return masks;
+    }
+#   define HTTPONY_JSON_INDEX_SIMD 1
+#elif defined(__SSE2__)
+    inline uint64_t simd_eq(const __m128i (&lanes)[4], char c)
+    {
+        __m128i chr = _mm_set1_epi8(c);
+        uint64_t result = 0;
+        for ( int i = 0; i < 4; i++ )
+            result |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(lanes[i], chr)))) << (16 * i);
+        return result;
+    }
+
+    /**
+     * \brief Classifies a block 16 characters at a time
+     */
+    inline BlockMasks scan_block_simd(const char* block)
+    {
+        __m128i lanes[4];
+        for ( int i = 0; i < 4; i++ )
+            lanes[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+        BlockMasks masks;
+        masks.backslash = simd_eq(lanes, '\\');
+        masks.quote = simd_eq(lanes, '"');
+        masks.operators = simd_eq(lanes, '{') | simd_eq(lanes, '}') |
+                          simd_eq(lanes, '[') | simd_eq(lanes, ']') |
+                          simd_eq(lanes, ':') | simd_eq(lanes, ',');
+        masks.whitespace = simd_eq(lanes, ' ') | simd_eq(lanes, '\t') |
+                           simd_eq(lanes, '\n') | simd_eq(lanes, '\r');
+        return masks;
+    }
+#   define HTTPONY_JSON_INDEX_SIMD 1
+#else
+    inline BlockMasks scan_block_simd(const char* block)
+    {
+        return scan_block_scalar(block);
+    }
+#   define HTTPONY_JSON_INDEX_SIMD 0
+#endif
+
+    /**
+     * \brief Computes a mask where each bit at position \c n is the xor
+     * of all bits in \p bits up to \c n
+     */
+    inline uint64_t prefix_xor(uint64_t bits)
+    {
+        bits ^= bits << 1;
+        bits ^= bits << 2;
+        bits ^= bits << 4;
+        bits ^= bits << 8;
+        bits ^= bits << 16;
+        bits ^= bits << 32;
+        return bits;
+    }
+
+    /**
+     * \brief Finds which characters are escaped by a backslash
+     * \param backslash         Backslash positions in the block
+     * \param[in,out] carry     Whether the first character of the block is
+     *                          escaped, updated for the next block
+     */
+    inline uint64_t escaped_mask(uint64_t backslash, uint64_t& carry)
+    {
+        constexpr uint64_t odd_bits = 0xAAAAAAAAAAAAAAAAull;
+        // Backslashes that aren't themselves escaped start a sequence,
+        // a sequence starting on an even bit escapes the character following
+        // an odd number of backslashes
+        uint64_t potential_escape = backslash & ~carry;
+        uint64_t maybe_escaped = potential_escape << 1;
+        uint64_t series = (maybe_escaped | odd_bits) - potential_escape;
+        uint64_t escape_and_terminal = series ^ odd_bits;
+        uint64_t escaped = escape_and_terminal ^ (backslash | carry);
+        carry = (escape_and_terminal & backslash) >> 63;
+        return escaped;
+    }
+
+} // namespace detail
+
+/**
+ * \brief Positions of the structural elements of a JSON document
+ *
+ * This is the first stage of JsonIndexedParser, it scans the input 64
+ * characters at a time (using SIMD instructions when the target supports
+ * them) and records the positions of operators, of opening quotes and
+ * of the first character of each literal that is outside strings.
+ */
+class StructuralIndex
+{
+public:
+    using position_type = uint32_t;
+
+    /**
+     * \brief Indexes \p size characters from \p data
+     * \param use_simd Whether to use the vectorized scanner when available
+     * \returns \b false if the document has an unterminated string or
+     *          is too large to be indexed
+     */
+    bool build(const char* data, std::size_t size, bool use_simd = true)
+    {
+        _positions.clear();
+        if ( size >= std::numeric_limits<position_type>::max() )
+            return false;
+
+        // Most documents have a structural element every few bytes
+        _positions.reserve(size / 4 + 8);
+
+        uint64_t escape_carry = 0;
+        uint64_t in_string_carry = 0;
+        uint64_t scalar_carry = 0;
+
+        std::size_t full_blocks = size / detail::index_block_size;
+        for ( std::size_t block = 0; block < full_blocks; block++ )
+        {
+            const char* start = data + block * detail::index_block_size;
+            index_block(
+                use_simd ? detail::scan_block_simd(start) : detail::scan_block_scalar(start),
+                block * detail::index_block_size,
+                escape_carry, in_string_carry, scalar_carry
+            );
+        }
+
+        std::size_t tail = size % detail::index_block_size;
+        if ( tail )
+        {
+            // The padding is whitespace so it doesn't produce structurals
+            char padded[detail::index_block_size];
+            std::memset(padded, ' ', detail::index_block_size);
+            std::memcpy(padded, data + size - tail, tail);
+            index_block(
+                use_simd ? detail::scan_block_simd(padded) : detail::scan_block_scalar(padded),
+                full_blocks * detail::index_block_size,
+                escape_carry, in_string_carry, scalar_carry
+            );
+        }
+
+        return !in_string_carry;
+    }
+
+    const std::vector<position_type>& positions() const
+    {
+        return _positions;
+    }
+
+    std::size_t size() const
+    {
+        return _positions.size();
+    }
+
+    position_type operator[](std::size_t index) const
+    {
+        return _positions[index];
+    }
+
+    /**
+     * \brief Whether the vectorized scanner is available on this target
+     */
+    static constexpr bool simd_available()
+    {
+        return HTTPONY_JSON_INDEX_SIMD;
+    }
+
+private:
+    void index_block(
+        const detail::BlockMasks& masks,
+        std::size_t offset,
+        uint64_t& escape_carry,
+        uint64_t& in_string_carry,
+        uint64_t& scalar_carry)
+    {
+        uint64_t escaped = detail::escaped_mask(masks.backslash, escape_carry);
+        uint64_t quotes = masks.quote & ~escaped;
+        // Includes opening quotes but not closing ones
+        uint64_t in_string = detail::prefix_xor(quotes) ^ in_string_carry;
+        in_string_carry = uint64_t(int64_t(in_string) >> 63);
+
+        uint64_t scalar = ~(masks.operators | masks.whitespace | quotes) & ~in_string;
+        uint64_t scalar_starts = scalar & ~((scalar << 1) | scalar_carry);
+        scalar_carry = scalar >> 63;
+
+        uint64_t structurals = (masks.operators & ~in_string) |
+                               (quotes & in_string) |
+                               scalar_starts;
+
+        while ( structurals )
+        {
+            _positions.push_back(position_type(offset + __builtin_ctzll(structurals)));
+            structurals &= structurals - 1;
+        }
+    }
+
+    std::vector<position_type> _positions;
+};
+
+/**
+ * \brief Two-stage JSON parser
+ *
+ * The document is first indexed with StructuralIndex, then the second
+ * stage walks the index either building a JsonNode or sending events to
+ * a JsonHandler.
+ *
+ * Unlike JsonParser it needs the whole document in contiguous memory and
+ * it only accepts strict JSON (no comments or unquoted strings), which makes
+ * it well suited for large machine-generated documents.
+ */
+class JsonIndexedParser
+{
+public:
+    using Tree = JsonNode;
+
+    /**
+     * \brief Parse \p size characters from \p data
+     * \throws JsonError On bad syntax
+     * \returns The tree populated from the data
+     */
+    const Tree& parse(const char* data, std::size_t size,
+                      const std::string& stream_name = "")
+    {
+        builder.clear();
+        parse(data, size, builder, stream_name);
+        return builder.tree();
+    }
+
+    /**
+     * \brief Parse the string
+     * \throws JsonError On bad syntax
+     * \returns The tree populated from the data
+     */
+    const Tree& parse_string(const std::string& json,
+                             const std::string& stream_name = "")
+    {
+        return parse(json.data(), json.size(), stream_name);
+    }
+
+    /**
+     * \brief Parse the stream
+     *
+     * The whole stream is read in memory before parsing
+     * \throws JsonError On bad syntax
+     * \returns The tree populated from the stream
+     */
+    const Tree& parse(std::istream& stream, const std::string& stream_name = "")
+    {
+        std::string json{
+            std::istreambuf_iterator<char>(stream),
+            std::istreambuf_iterator<char>()
+        };
+        return parse_string(json, stream_name);
+    }
+
+    /**
+     * \brief Parse \p size characters from \p data, notifying \p handler
+     * \tparam Handler A class with the same interface as JsonHandler
+     * \throws JsonError On bad syntax
+     * \returns \b false if the parser has been stopped by the handler
+     *          or an error occurred
+     */
+    template<class Handler>
+        bool parse(const char* data, std::size_t size, Handler& handler,
+                   const std::string& stream_name = "")
+    {
+        this->data = data;
+        this->data_size = size;
+        this->stream_name = stream_name;
+        error_flag = false;
+
+        if ( nothrow )
+        {
+            try {
+                return parse_root(handler);
+            } catch ( const JsonError& ) {
+                error_flag = true;
+                return false;
+            }
+        }
+
+        return parse_root(handler);
+    }
+
+    /**
+     * \brief This can be used to get partial trees on errors
+     */
+    const Tree& tree() const
+    {
+        return builder.tree();
+    }
+
+    /**
+     * \brief Whether there has been a parsing error
+     */
+    bool error() const
+    {
+        return error_flag;
+    }
+
+    /**
+     * \brief Whether the parser can throw
+     */
+    bool throws() const
+    {
+        return !nothrow;
+    }
+
+    /**
+     * \brief Sets whether the parser can throw
+     */
+    void throws(bool throws)
+    {
+        nothrow = !throws;
+    }
+
+private:
+    /**
+     * \brief Throws an exception pointing to the line of \p position
+     */
+    void error /*[[noreturn]]*/ (const std::string& message, std::size_t position)
+    {
+        position = std::min(position, data_size);
+        int line = 1 + std::count(data, data + position, '\n');
+        throw JsonError(stream_name, line, message);
+    }
+
+    /**
+     * \brief Walks the structural index
+     */
+    template<class Handler>
+        bool parse_root(Handler& handler)
+    {
+        if ( !index.build(data, data_size) )
+            error("Unterminated string", data_size);
+
+        if ( index.size() == 0 )
+            return true;
+
+        enum class State
+        {
+            Value,      ///< Expecting a value
+            Key,        ///< Expecting an object key
+            AfterValue, ///< Expecting a separator or the end of a container
+        };
+
+        // true for objects, false for arrays
+        std::vector<bool> stack;
+        State state = State::Value;
+        std::size_t i = 0;
+        std::size_t count = index.size();
+
+        while ( true )
+        {
+            if ( state == State::AfterValue )
+            {
+                if ( stack.empty() )
+                {
+                    if ( i != count )
+                        error("Unexpected data after the root value", index[i]);
+                    return true;
+                }
+
+                if ( i == count )
+                    error("Abrupt ending", data_size);
+
+                std::size_t pos = index[i++];
+                char c = data[pos];
+                if ( c == ',' )
+                {
+                    state = stack.back() ? State::Key : State::Value;
+                }
+                else if ( stack.back() && c == '}' )
+                {
+                    stack.pop_back();
+                    if ( !handler.end_object() )
+                        return false;
+                }
+                else if ( !stack.back() && c == ']' )
+                {
+                    stack.pop_back();
+                    if ( !handler.end_array() )
+                        return false;
+                }
+                else
+                {
+                    error(stack.back() ? "Expected } or ," : "Expected ] or ,", pos);
+                }
+            }
+            else if ( state == State::Key )
+            {
+                if ( i + 1 >= count )
+                    error("Abrupt ending", data_size);
+
+                std::size_t pos = index[i++];
+                if ( data[pos] != '"' )
+                    error("Expected property name", pos);
+                if ( !handler.key(parse_string(pos)) )
+                    return false;
+
+                pos = index[i++];
+                if ( data[pos] != ':' )
+                    error("Expected :", pos);
+                state = State::Value;
+            }
+            else
+            {
+                if ( i == count )
+                    error("Abrupt ending", data_size);
+
+                std::size_t pos = index[i++];
+                char c = data[pos];
+                state = State::AfterValue;
+                if ( c == '{' )
+                {
+                    if ( !handler.start_object() )
+                        return false;
+                    if ( i < count && data[index[i]] == '}' )
+                    {
+                        i++;
+                        if ( !handler.end_object() )
+                            return false;
+                    }
+                    else
+                    {
+                        stack.push_back(true);
+                        state = State::Key;
+                    }
+                }
+                else if ( c == '[' )
+                {
+                    if ( !handler.start_array() )
+                        return false;
+                    if ( i < count && data[index[i]] == ']' )
+                    {
+                        i++;
+                        if ( !handler.end_array() )
+                            return false;
+                    }
+                    else
+                    {
+                        stack.push_back(false);
+                        state = State::Value;
+                    }
+                }
+                else if ( c == '"' )
+                {
+                    if ( !handler.string(parse_string(pos)) )
+                        return false;
+                }
+                else if ( !parse_literal(pos, handler) )
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    /**
+     * \brief Parses a string literal starting with the quote at \p pos
+     * \pre The string is terminated (as validated by the index)
+     */
+    std::string parse_string(std::size_t pos)
+    {
+        std::string result;
+        const char* iter = data + pos + 1;
+        const char* end = data + data_size;
+        auto next = [&iter, end]() -> int {
+            return iter < end ? (unsigned char)(*iter++) : -1;
+        };
+
+        while ( true )
+        {
+            // Copies unescaped runs in bulk
+            const char* run = iter;
+            while ( iter < end && detail::raw_string_char(*iter) )
+                ++iter;
+            if ( iter != run )
+                result.append(run, iter);
+
+            if ( iter >= end )
+                error("Unterminated string", data_size);
+            if ( *iter == '"' )
+                break;
+            if ( *iter != '\\' )
+                error("Control character in string", iter - data);
+
+            ++iter;
+            if ( const char* message = detail::unescape(next, result) )
+                error(message, iter - data);
+        }
+
+        return result;
+    }
+
+    /**
+     * \brief Parses number, boolean and null literals
+     */
+    template<class Handler>
+        bool parse_literal(std::size_t pos, Handler& handler)
+    {
+        std::size_t end = pos;
+        while ( end < data_size && !is_delimiter(data[end]) )
+            end++;
+
+        std::string token(data + pos, end - pos);
+
+        if ( token == "true" )
+            return handler.boolean(true);
+        if ( token == "false" )
+            return handler.boolean(false);
+        if ( token == "null" )
+            return handler.null();
+
+        if ( !detail::valid_number(token) )
+            error("Expected value", pos);
+
+        return handler.number(token);
+    }
+
+    /**
+     * \brief Whether \p c terminates a literal
+     */
+    static bool is_delimiter(char c)
+    {
+        switch ( c )
+        {
+            case '{': case '}': case '[': case ']': case ':': case ',':
+            case ' ': case '\t': case '\n': case '\r': case '"':
+                return true;
+        }
+        return false;
+    }
+
+    StructuralIndex index;
+    JsonTreeBuilder builder;
+    const char* data = nullptr;     ///< Input data
+    std::size_t data_size = 0;      ///< Size of data
+    std::string stream_name;        ///< Name of the file
+    bool nothrow = false;           ///< If true, don't throw
+    bool error_flag = false;        ///< If true, there has been an error
+};
+
+} // namespace json
+} // namespace httpony
+#endif // HTTPONY_JSON_INDEX_HPP
@@ -0,0 +1,498 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef HTTPONY_JSON_STREAM_HPP
+#define HTTPONY_JSON_STREAM_HPP
+
+/// \cond
+#include <algorithm>
+#include <istream>
+#include <vector>
+/// \endcond
+
+#include "httpony/formats/json.hpp"
+
+namespace httpony {
+namespace json {
+
+/**
+ * \brief Incremental JSON reader
+ *
+ * Reads one token at a time from a stream (such as io::ContentStream),
+ * so documents can be validated, filtered or forwarded without building
+ * a tree for them.
+ *
+ * Like JsonIndexedParser it only accepts strict JSON.
+ */
+class JsonReader
+{
+public:
+    enum class Event
+    {
+        End,            ///< The whole document has been read
+        StartObject,
+        EndObject,
+        StartArray,
+        EndArray,
+        Key,            ///< value() is the key
+        String,         ///< value() is the unescaped string
+        Number,         ///< value() is the number as it appears in the source
+        Boolean,        ///< value() is "true" or "false"
+        Null,
+    };
+
+    explicit JsonReader(std::istream& stream, std::string stream_name = "")
+        : buffer(stream.rdbuf()),
+          stream_name(std::move(stream_name))
+    {}
+
+    explicit JsonReader(std::streambuf* buffer, std::string stream_name = "")
+        : buffer(buffer),
+          stream_name(std::move(stream_name))
+    {}
+
+    /**
+     * \brief Reads the next event
+     * \throws JsonError On bad syntax or if the stream ends too early
+     */
+    Event next()
+    {
+        while ( true )
+        {
+            switch ( state )
+            {
+                case State::Done:
+                    if ( skip_ws() != eof )
+                        error("Unexpected data after the root value");
+                    return last_event = Event::End;
+
+                case State::AfterValue:
+                {
+                    if ( stack.empty() )
+                    {
+                        state = State::Done;
+                        continue;
+                    }
+                    int c = get_skipws();
+                    if ( c == ',' )
+                    {
+                        state = stack.back().object ? State::Key : State::Value;
+                        continue;
+                    }
+                    if ( stack.back().object && c == '}' )
+                    {
+                        stack.pop_back();
+                        return last_event = Event::EndObject;
+                    }
+                    if ( !stack.back().object && c == ']' )
+                    {
+                        stack.pop_back();
+                        return last_event = Event::EndArray;
+                    }
+                    error(stack.back().object ? "Expected } or ," : "Expected ] or ,");
+                }
+
+                case State::FirstKey:
+                    if ( skip_ws() == '}' )
+                    {
+                        buffer->sbumpc();
+                        stack.pop_back();
+                        state = State::AfterValue;
+                        return last_event = Event::EndObject;
+                    }
+                    // fallthrough
+                case State::Key:
+                {
+                    if ( get_skipws() != '"' )
+                        error("Expected property name");
+                    read_string(stack.back().key);
+                    if ( get_skipws() != ':' )
+                        error("Expected :");
+                    state = State::Value;
+                    _value = stack.back().key;
+                    return last_event = Event::Key;
+                }
+
+                case State::FirstValue:
+                    if ( skip_ws() == ']' )
+                    {
+                        buffer->sbumpc();
+                        stack.pop_back();
+                        state = State::AfterValue;
+                        return last_event = Event::EndArray;
+                    }
+                    // fallthrough
+                case State::Value:
+                    return last_event = read_value();
+            }
+        }
+    }
+
+    /**
+     * \brief Value associated with the last event
+     */
+    const std::string& value() const
+    {
+        return _value;
+    }
+
+    /**
+     * \brief Last event returned by next()
+     */
+    Event event() const
+    {
+        return last_event;
+    }
+
+    /**
+     * \brief Number of open objects and arrays
+     */
+    std::size_t depth() const
+    {
+        return stack.size();
+    }
+
+    /**
+     * \brief Path of the last value, in the format used by JsonNode::get()
+     *
+     * For StartObject and StartArray it's the path of the container itself.
+     */
+    std::string path() const
+    {
+        std::string result;
+        std::size_t size = stack.size();
+        if ( size && value_starts_container() )
+            size--;
+        for ( std::size_t i = 0; i < size; i++ )
+        {
+            if ( i )
+                result += '.';
+            result += stack[i].key;
+        }
+        return result;
+    }
+
+    /**
+     * \brief Skips the rest of the value started by the last event
+     *
+     * If the last event was StartObject or StartArray, it reads until the
+     * matching end event, otherwise it does nothing.
+     */
+    void skip()
+    {
+        if ( !value_starts_container() )
+            return;
+
+        std::size_t target = stack.size() - 1;
+        while ( stack.size() > target )
+            next();
+    }
+
+    /**
+     * \brief Builds a JsonNode for the value started by the last event
+     */
+    JsonNode read_node()
+    {
+        JsonTreeBuilder builder;
+        if ( value_starts_container() )
+        {
+            std::size_t target = stack.size() - 1;
+            dispatch(last_event, builder);
+            while ( stack.size() > target )
+                dispatch(next(), builder);
+        }
+        else
+        {
+            dispatch(last_event, builder);
+        }
+        return std::move(builder.tree());
+    }
+
+    /**
+     * \brief Reads the rest of the document, notifying \p handler
+     * \tparam Handler A class with the same interface as JsonHandler
+     * \returns \b false if the handler stopped the parser
+     */
+    template<class Handler>
+        bool parse(Handler& handler)
+    {
+        while ( true )
+        {
+            Event event = next();
+            if ( event == Event::End )
+                return true;
+            if ( !dispatch(event, handler) )
+                return false;
+        }
+    }
+
+    /**
+     * \brief Reads the rest of the document and extracts only the values
+     * at the given paths
+     *
+     * Paths are in the same format as the ones passed to JsonNode::get(),
+     * a \c * component matches any key or array index.
+     * Containers that can't contain any of the requested paths are skipped
+     * without being built.
+     *
+     * \param paths     Paths to extract
+     * \param callback  Called with the path and the node of each match,
+     *                  returning \b false stops the reader
+     * \returns \b false if the callback stopped the reader
+     */
+    template<class Callback>
+        bool extract(const std::vector<std::string>& paths, const Callback& callback)
+    {
+        std::vector<std::vector<std::string>> patterns;
+        patterns.reserve(paths.size());
+        for ( const auto& path : paths )
+            patterns.push_back(melanolib::string::char_split(path, '.'));
+
+        std::vector<std::string> segments;
+        while ( true )
+        {
+            Event event = next();
+            if ( event == Event::End )
+                return true;
+            if ( event == Event::Key || event == Event::EndObject || event == Event::EndArray )
+                continue;
+
+            segments.clear();
+            std::size_t size = stack.size() - (value_starts_container() ? 1 : 0);
+            for ( std::size_t i = 0; i < size; i++ )
+                segments.push_back(stack[i].key);
+
+            bool prefix = false;
+            bool matched = false;
+            for ( const auto& pattern : patterns )
+            {
+                if ( pattern.size() < segments.size() )
+                    continue;
+                if ( !std::equal(segments.begin(), segments.end(), pattern.begin(),
+                    [](const std::string& segment, const std::string& pattern) {
+                        return pattern == "*" || pattern == segment;
+                    }) )
+                    continue;
+                if ( pattern.size() == segments.size() )
+                    matched = true;
+                else
+                    prefix = true;
+            }
+
+            if ( matched )
+            {
+                std::string path = this->path();
+                if ( !callback(path, read_node()) )
+                    return false;
+            }
+            else if ( !prefix )
+            {
+                skip();
+            }
+        }
+    }
+
+    /**
+     * \brief Throws an exception at the current line
+     *
+     * Can be used by consumers to report values they don't expect
+     */
+    void error /*[[noreturn]]*/ (const std::string& message) const
+    {
+        throw JsonError(stream_name, line, message);
+    }
+
+private:
+    enum class State
+    {
+        Value,      ///< Expecting a value
+        FirstValue, ///< Expecting a value or the end of an array
+        Key,        ///< Expecting an object key
+        FirstKey,   ///< Expecting a key or the end of an object
+        AfterValue, ///< Expecting a separator or the end of a container
+        Done,       ///< Read the root value
+    };
+
+    struct Frame
+    {
+        bool object;
+        std::size_t index = 0;
+        std::string key;
+
+        explicit Frame(bool object) : object(object) {}
+    };
+
+    static constexpr int eof = std::char_traits<char>::eof();
+
+    /**
+     * \brief Whether the last event opened a container
+     */
+    bool value_starts_container() const
+    {
+        return last_event == Event::StartObject || last_event == Event::StartArray;
+    }
+
+    /**
+     * \brief Forwards \p event to \p handler
+     */
+    template<class Handler>
+        bool dispatch(Event event, Handler& handler)
+    {
+        switch ( event )
+        {
+            case Event::StartObject:    return handler.start_object();
+            case Event::EndObject:      return handler.end_object();
+            case Event::StartArray:     return handler.start_array();
+            case Event::EndArray:       return handler.end_array();
+            case Event::Key:            return handler.key(_value);
+            case Event::String:         return handler.string(_value);
+            case Event::Number:         return handler.number(_value);
+            case Event::Boolean:        return handler.boolean(_value == "true");
+            case Event::Null:           return handler.null();
+            case Event::End:            break;
+        }
+        return true;
+    }
+
+    /**
+     * \brief Reads a value after skipping whitespace
+     */
+    Event read_value()
+    {
+        int c = get_skipws();
+
+        if ( !stack.empty() && !stack.back().object )
+            stack.back().key = std::to_string(stack.back().index++);
+
+        state = State::AfterValue;
+        switch ( c )
+        {
+            case '{':
+                stack.emplace_back(true);
+                state = State::FirstKey;
+                return Event::StartObject;
+            case '[':
+                stack.emplace_back(false);
+                state = State::FirstValue;
+                return Event::StartArray;
+            case '"':
+                read_string(_value);
+                return Event::String;
+            case eof:
+                error("Abrupt ending");
+        }
+
+        _value.clear();
+        _value += char(c);
+        while ( true )
+        {
+            c = buffer->sgetc();
+            if ( c == eof || !is_literal_char(c) )
+                break;
+            _value += char(c);
+            buffer->sbumpc();
+        }
+
+        if ( _value == "true" || _value == "false" )
+            return Event::Boolean;
+        if ( _value == "null" )
+            return Event::Null;
+        if ( !detail::valid_number(_value) )
+            error("Expected value");
+        return Event::Number;
+    }
+
+    /**
+     * \brief Reads a string literal after the opening quote
+     */
+    void read_string(std::string& output)
+    {
+        output.clear();
+        // eof is negative, as unescape() expects
+        auto next = [this]() -> int { return buffer->sbumpc(); };
+
+        while ( true )
+        {
+            int c = buffer->sbumpc();
+            if ( c == eof )
+                error("Unterminated string");
+            if ( c == '"' )
+                return;
+
+            if ( c != '\\' )
+            {
+                if ( !detail::raw_string_char(c) )
+                    error("Control character in string");
+                output += char(c);
+                continue;
+            }
+
+            if ( const char* message = detail::unescape(next, output) )
+                error(message);
+        }
+    }
+
+    /**
+     * \brief Whether \p c can be part of a number or keyword
+     */
+    static bool is_literal_char(int c)
+    {
+        return melanolib::string::ascii::is_alnum(c) ||
+            c == '-' || c == '+' || c == '.';
+    }
+
+    /**
+     * \brief Skips whitespace and returns the next character without
+     * extracting it
+     */
+    int skip_ws()
+    {
+        while ( true )
+        {
+            int c = buffer->sgetc();
+            if ( c == '\n' )
+                line++;
+            else if ( c != ' ' && c != '\t' && c != '\r' )
+                return c;
+            buffer->sbumpc();
+        }
+    }
+
+    /**
+     * \brief Skips whitespace and extracts the next character
+     */
+    int get_skipws()
+    {
+        skip_ws();
+        return buffer->sbumpc();
+    }
+
+    std::streambuf* buffer;     ///< Input buffer
+    std::string stream_name;    ///< Name of the file
+    int line = 1;               ///< Line number
+    State state = State::Value; ///< What's expected next
+    Event last_event = Event::End;
+    std::string _value;         ///< Value of the last event
+    std::vector<Frame> stack;   ///< Open containers
+};
+
+} // namespace json
+} // namespace httpony
+#endif // HTTPONY_JSON_STREAM_HPP
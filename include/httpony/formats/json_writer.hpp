@@ -0,0 +1,491 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef HTTPONY_JSON_WRITER_HPP
+#define HTTPONY_JSON_WRITER_HPP
+
+/// \cond
+#include <cmath>
+#include <cstring>
+#include <ostream>
+#include <vector>
+/// \endcond
+
+#include "httpony/formats/json.hpp"
+#include "httpony/util/number_format.hpp"
+
+namespace httpony {
+namespace json {
+
+/**
+ * \brief Writes JSON directly to a stream or a string
+ *
+ * Output is staged in a small buffer and forwarded to the target in
+ * blocks, call flush() to make the data written so far visible on the
+ * target (eg: between chunks of a streaming response).
+ *
+ * Its member functions have the same names as JsonHandler so it can be
+ * used as a handler for the parsers to re-serialize their input.
+ */
+class JsonWriter
+{
+public:
+    /**
+     * \param out       Output stream, its buffer must be set
+     * \param indent    Number of spaces for each indentation level,
+     *                  if 0 the output is compact
+     */
+    explicit JsonWriter(std::ostream& out, int indent = 0)
+        : output_buffer(out.rdbuf()),
+          indent(indent)
+    {}
+
+    /**
+     * \param out       String to append the output to
+     * \param indent    Number of spaces for each indentation level,
+     *                  if 0 the output is compact
+     */
+    explicit JsonWriter(std::string& out, int indent = 0)
+        : output_string(&out),
+          indent(indent)
+    {}
+
+    JsonWriter(const JsonWriter&) = delete;
+    JsonWriter& operator=(const JsonWriter&) = delete;
+
+    ~JsonWriter()
+    {
+        flush();
+    }
+
+    /**
+     * \brief Sends the staged output to the target
+     */
+    void flush()
+    {
+        if ( !staged )
+            return;
+        if ( output_string )
+            output_string->append(stage, staged);
+        else if ( output_buffer )
+            output_buffer->sputn(stage, staged);
+        staged = 0;
+    }
+
+    /**
+     * \brief Whether non-ASCII characters are written as \\u escapes
+     *
+     * This is the default, as it matches JsonNode::format(), if disabled
+     * strings are copied as UTF-8.
+     */
+    void escape_unicode(bool escape)
+    {
+        unicode_escape = escape;
+    }
+
+    bool start_object()
+    {
+        return open('{', true);
+    }
+
+    bool end_object()
+    {
+        return close('}');
+    }
+
+    bool start_array()
+    {
+        return open('[', false);
+    }
+
+    bool end_array()
+    {
+        return close(']');
+    }
+
+    /**
+     * \brief Writes an object key, must be followed by a value
+     */
+    bool key(const std::string& name)
+    {
+        return key(name.data(), name.size());
+    }
+
+    bool key(const char* name, std::size_t size)
+    {
+        before_value();
+        write_quoted(name, size);
+        put(':');
+        if ( indent )
+            put(' ');
+        after_key = true;
+        return true;
+    }
+
+    bool string(const std::string& value)
+    {
+        before_value();
+        write_quoted(value.data(), value.size());
+        return true;
+    }
+
+    /**
+     * \brief Writes a number which is already formatted
+     */
+    bool number(const std::string& raw)
+    {
+        before_value();
+        write(raw.data(), raw.size());
+        return true;
+    }
+
+    bool boolean(bool value)
+    {
+        before_value();
+        if ( value )
+            write("true", 4);
+        else
+            write("false", 5);
+        return true;
+    }
+
+    bool null()
+    {
+        before_value();
+        write("null", 4);
+        return true;
+    }
+
+    JsonWriter& value(const std::string& value)
+    {
+        string(value);
+        return *this;
+    }
+
+    JsonWriter& value(const char* value)
+    {
+        before_value();
+        write_quoted(value, std::strlen(value));
+        return *this;
+    }
+
+    JsonWriter& value(bool value)
+    {
+        boolean(value);
+        return *this;
+    }
+
+    JsonWriter& value(std::nullptr_t)
+    {
+        null();
+        return *this;
+    }
+
+    JsonWriter& value(long long value)
+    {
+        before_value();
+        char buffer[number::max_integer_size];
+        write(buffer, number::format_integer(buffer, value) - buffer);
+        return *this;
+    }
+
+    JsonWriter& value(unsigned long long value)
+    {
+        before_value();
+        char buffer[number::max_integer_size];
+        write(buffer, number::format_integer(buffer, value) - buffer);
+        return *this;
+    }
+
+    JsonWriter& value(long value) { return this->value((long long)value); }
+    JsonWriter& value(int value) { return this->value((long long)value); }
+    JsonWriter& value(unsigned long value) { return this->value((unsigned long long)value); }
+    JsonWriter& value(unsigned value) { return this->value((unsigned long long)value); }
+
+    /**
+     * \brief Writes a floating point number
+     *
+     * Uses the shortest representation that reads back to the same value,
+     * non-finite values can't be represented in JSON and are written as null
+     */
+    JsonWriter& value(double value)
+    {
+        before_value();
+        if ( !std::isfinite(value) )
+        {
+            write("null", 4);
+            return *this;
+        }
+
+        char buffer[number::max_double_size];
+        write(buffer, number::format_double(buffer, value) - buffer);
+        return *this;
+    }
+
+    /**
+     * \brief Writes a whole tree
+     */
+    JsonWriter& value(const JsonNode& node)
+    {
+        switch ( node.type() )
+        {
+            case JsonNode::Null:
+                null();
+                break;
+            case JsonNode::String:
+                string(node.raw_value());
+                break;
+            case JsonNode::Number:
+                number(node.raw_value());
+                break;
+            case JsonNode::Boolean:
+                boolean(node.raw_value() == "true");
+                break;
+            case JsonNode::Object:
+                start_object();
+                for ( const auto& pair : node )
+                {
+                    key(pair.first);
+                    value(pair.second);
+                }
+                end_object();
+                break;
+            case JsonNode::Array:
+                start_array();
+                for ( const auto& pair : node )
+                    value(pair.second);
+                end_array();
+                break;
+        }
+        return *this;
+    }
+
+    /**
+     * \brief Writes a key and its value
+     */
+    template<class T>
+        JsonWriter& member(const std::string& name, const T& value)
+    {
+        key(name);
+        return this->value(value);
+    }
+
+    /**
+     * \brief Number of open objects and arrays
+     */
+    std::size_t depth() const
+    {
+        return stack.size();
+    }
+
+private:
+    struct Frame
+    {
+        bool object;
+        bool empty = true;
+
+        explicit Frame(bool object) : object(object) {}
+    };
+
+    static constexpr std::size_t stage_size = 4096;
+
+    void put(char c)
+    {
+        if ( staged == stage_size )
+            flush();
+        stage[staged++] = c;
+    }
+
+    void write(const char* data, std::size_t size)
+    {
+        if ( size > stage_size - staged )
+        {
+            flush();
+            if ( size >= stage_size )
+            {
+                if ( output_string )
+                    output_string->append(data, size);
+                else if ( output_buffer )
+                    output_buffer->sputn(data, size);
+                return;
+            }
+        }
+        std::memcpy(stage + staged, data, size);
+        staged += size;
+    }
+
+    void write_indent()
+    {
+        if ( !indent )
+            return;
+        put('\n');
+        for ( std::size_t i = 0, n = indent * stack.size(); i < n; i++ )
+            put(' ');
+    }
+
+    /**
+     * \brief Writes separators and indentation before a value or key
+     */
+    void before_value()
+    {
+        if ( after_key )
+        {
+            after_key = false;
+            return;
+        }
+
+        if ( stack.empty() )
+            return;
+
+        if ( !stack.back().empty )
+            put(',');
+        stack.back().empty = false;
+        write_indent();
+    }
+
+    bool open(char c, bool object)
+    {
+        before_value();
+        put(c);
+        stack.emplace_back(object);
+        return true;
+    }
+
+    bool close(char c)
+    {
+        bool empty = stack.back().empty;
+        stack.pop_back();
+        if ( !empty )
+            write_indent();
+        put(c);
+        return true;
+    }
+
+    void write_uniescape(uint32_t point)
+    {
+        static const char hex[] = "0123456789abcdef";
+        char buffer[6] = {'\\', 'u'};
+        for ( int i = 0; i < 4; i++ )
+            buffer[2 + i] = hex[(point >> (12 - 4 * i)) & 0xf];
+        write(buffer, 6);
+    }
+
+    /**
+     * \brief Decodes the UTF-8 sequence starting at \p iter
+     * \returns The code point or U+FFFD on invalid input
+     */
+    static uint32_t decode_utf8(const unsigned char*& iter, const unsigned char* end)
+    {
+        unsigned char lead = *iter++;
+        int length;
+        uint32_t point;
+        if ( (lead & 0xe0) == 0xc0 )
+        {
+            length = 1;
+            point = lead & 0x1f;
+        }
+        else if ( (lead & 0xf0) == 0xe0 )
+        {
+            length = 2;
+            point = lead & 0x0f;
+        }
+        else if ( (lead & 0xf8) == 0xf0 )
+        {
+            length = 3;
+            point = lead & 0x07;
+        }
+        else
+        {
+            return 0xfffd;
+        }
+
+        for ( ; length > 0; length-- )
+        {
+            if ( iter == end || (*iter & 0xc0) != 0x80 )
+                return 0xfffd;
+            point = (point << 6) | (*iter++ & 0x3f);
+        }
+        return point;
+    }
+
+    /**
+     * \brief Writes a quoted string, copying runs that need no escaping
+     * in bulk
+     */
+    void write_quoted(const char* data, std::size_t size)
+    {
+        put('"');
+        const unsigned char* iter = reinterpret_cast<const unsigned char*>(data);
+        const unsigned char* end = iter + size;
+        while ( iter != end )
+        {
+            const unsigned char* run = iter;
+            while ( iter != end && *iter >= 0x20 && *iter != '"' &&
+                    *iter != '\\' && *iter != '/' &&
+                    (*iter < 0x80 || !unicode_escape) )
+                ++iter;
+            write(reinterpret_cast<const char*>(run), iter - run);
+
+            if ( iter == end )
+                break;
+
+            char c = *iter;
+            if ( *iter >= 0x80 )
+            {
+                uint32_t point = decode_utf8(iter, end);
+                if ( melanolib::string::Utf8Parser::can_split_surrogates(point) )
+                {
+                    auto pair = melanolib::string::Utf8Parser::split_surrogates(point);
+                    write_uniescape(pair.first);
+                    write_uniescape(pair.second);
+                }
+                else
+                {
+                    write_uniescape(point);
+                }
+            }
+            else if ( detail::escapeable(c) )
+            {
+                put('\\');
+                put(detail::escape(c));
+                ++iter;
+            }
+            else
+            {
+                // Control characters without a short escape
+                write_uniescape(*iter++);
+            }
+        }
+        put('"');
+    }
+
+    std::streambuf* output_buffer = nullptr;    ///< Output stream buffer
+    std::string* output_string = nullptr;       ///< Output string
+    char stage[stage_size];                     ///< Staged output
+    std::size_t staged = 0;                     ///< Number of staged bytes
+    int indent = 0;                             ///< Spaces per level
+    bool unicode_escape = true;                 ///< Escape non-ASCII
+    bool after_key = false;                     ///< Whether a key has just been written
+    std::vector<Frame> stack;                   ///< Open containers
+};
+
+} // namespace json
+} // namespace httpony
+#endif // HTTPONY_JSON_WRITER_HPP
@@ -0,0 +1,402 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef HTTPONY_NDJSON_HPP
+#define HTTPONY_NDJSON_HPP
+
+/// \cond
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+/// \endcond
+
+#include "httpony/formats/json_index.hpp"
+
+namespace httpony {
+namespace json {
+
+/**
+ * \brief Parses newline-delimited JSON (one document per line) on
+ * multiple threads
+ *
+ * The input is split at line boundaries, consecutive records are grouped
+ * in chunks and the chunks are parsed with JsonIndexedParser by a set of
+ * worker threads.
+ *
+ * In ordered mode the callback is invoked on the calling thread in the
+ * same order as the records appear in the input, workers can only get a
+ * limited number of chunks ahead of it.
+ * In unordered mode the callback is invoked as soon as a chunk is parsed,
+ * possibly from a worker thread (invocations are serialized).
+ *
+ * The callback receives the sequence number of the record (counting
+ * non-blank lines from 0) and its tree, returning \b false stops the parser.
+ */
+class NdjsonParser
+{
+public:
+    /**
+     * \param threads Number of threads, 0 to use all the available cores
+     */
+    explicit NdjsonParser(unsigned threads = 0)
+    {
+        this->threads(threads);
+    }
+
+    unsigned threads() const
+    {
+        return thread_count;
+    }
+
+    void threads(unsigned threads)
+    {
+        if ( threads == 0 )
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        thread_count = threads;
+    }
+
+    bool ordered() const
+    {
+        return in_order;
+    }
+
+    /**
+     * \brief Sets whether records are delivered in input order
+     */
+    void ordered(bool ordered)
+    {
+        in_order = ordered;
+    }
+
+    /**
+     * \brief Sets the number of records processed by a thread in one go
+     */
+    void chunk_size(std::size_t records)
+    {
+        chunk_records = std::max<std::size_t>(1, records);
+    }
+
+    /**
+     * \brief Parses \p size characters from \p data
+     * \param callback Functor with the signature
+     *                 <tt>bool (std::size_t sequence, JsonNode&& tree)</tt>
+     * \throws JsonError On the first (in order) record with bad syntax,
+     *         in ordered mode all records before it have been delivered
+     * \returns \b false if the callback stopped the parser
+     */
+    template<class Callback>
+        bool parse(const char* data, std::size_t size, const Callback& callback,
+                   const std::string& stream_name = "")
+    {
+        Job job(split(data, size), chunk_records, stream_name);
+        if ( job.chunks.empty() )
+            return true;
+
+        unsigned workers = std::min<std::size_t>(thread_count, job.chunks.size());
+
+        // Used by the workers in unordered mode, must outlive them
+        auto deliver = [&job, &callback](Chunk& chunk) {
+            std::lock_guard<std::mutex> lock(job.callback_mutex);
+            try {
+                job.deliver(chunk, callback);
+            } catch ( ... ) {
+                // Forwarded to the calling thread
+                job.callback_error = std::current_exception();
+                job.stop();
+            }
+        };
+        std::vector<std::thread> pool;
+
+        try
+        {
+            if ( in_order )
+            {
+                job.window = 2 * workers;
+                for ( unsigned i = 0; i < workers; i++ )
+                    pool.emplace_back([&job]{ job.work(); });
+                deliver_ordered(job, callback);
+            }
+            else
+            {
+                for ( unsigned i = 1; i < workers; i++ )
+                    pool.emplace_back([&job, &deliver]{ job.work(deliver); });
+                job.work(deliver);
+            }
+        }
+        catch ( ... )
+        {
+            job.stop();
+            for ( auto& thread : pool )
+                thread.join();
+            throw;
+        }
+
+        for ( auto& thread : pool )
+            thread.join();
+
+        if ( job.callback_error )
+            std::rethrow_exception(job.callback_error);
+        if ( job.callback_stopped )
+            return false;
+        job.rethrow();
+        return true;
+    }
+
+    template<class Callback>
+        bool parse_string(const std::string& ndjson, const Callback& callback,
+                          const std::string& stream_name = "")
+    {
+        return parse(ndjson.data(), ndjson.size(), callback, stream_name);
+    }
+
+    /**
+     * \brief Reads the whole stream in memory and parses it
+     */
+    template<class Callback>
+        bool parse(std::istream& stream, const Callback& callback,
+                   const std::string& stream_name = "")
+    {
+        std::string ndjson{
+            std::istreambuf_iterator<char>(stream),
+            std::istreambuf_iterator<char>()
+        };
+        return parse_string(ndjson, callback, stream_name);
+    }
+
+private:
+    struct Record
+    {
+        const char* data;
+        std::size_t size;
+        std::size_t line;
+    };
+
+    struct Chunk
+    {
+        std::size_t first = 0;                  ///< Index of the first record
+        std::size_t last = 0;                   ///< Index past the last record
+        std::vector<JsonNode> trees;            ///< Parsed records
+        std::exception_ptr error;               ///< Error on the record after the trees
+        bool done = false;
+    };
+
+    /**
+     * \brief State shared by the threads working on the same input
+     */
+    struct Job
+    {
+        Job(std::vector<Record> records, std::size_t chunk_records, const std::string& stream_name)
+            : records(std::move(records)),
+              stream_name(stream_name)
+        {
+            std::size_t count = (this->records.size() + chunk_records - 1) / chunk_records;
+            chunks.resize(count);
+            for ( std::size_t i = 0; i < count; i++ )
+            {
+                chunks[i].first = i * chunk_records;
+                chunks[i].last = std::min(this->records.size(), (i + 1) * chunk_records);
+            }
+        }
+
+        /**
+         * \brief Parses chunks until they run out, notifying the
+         * ordered consumer
+         */
+        void work()
+        {
+            work([this](Chunk&) {
+                std::lock_guard<std::mutex> lock(mutex);
+                condition.notify_all();
+            });
+        }
+
+        /**
+         * \brief Parses chunks until they run out, calling \p on_done
+         * after each one
+         */
+        template<class OnDone>
+            void work(const OnDone& on_done)
+        {
+            JsonIndexedParser parser;
+            JsonTreeBuilder builder;
+            while ( Chunk* chunk = claim() )
+            {
+                for ( std::size_t i = chunk->first; i < chunk->last && !stopped; i++ )
+                {
+                    const Record& record = records[i];
+                    builder.clear();
+                    try
+                    {
+                        parser.parse(record.data, record.size, builder, stream_name);
+                    }
+                    catch ( const JsonError& error )
+                    {
+                        chunk->error = std::make_exception_ptr(JsonError(
+                            error.file, record.line + error.line - 1, error.what()
+                        ));
+                        break;
+                    }
+                    chunk->trees.push_back(std::move(builder.tree()));
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    chunk->done = true;
+                }
+                on_done(*chunk);
+                // Without ordering there's no point in parsing the rest
+                if ( chunk->error && !window )
+                    stop();
+            }
+        }
+
+        /**
+         * \brief Reserves the next chunk for the current thread
+         * \returns \b nullptr if there are no more chunks
+         */
+        Chunk* claim()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]{
+                return stopped || !window || next_chunk < delivered + window;
+            });
+            if ( stopped || next_chunk >= chunks.size() )
+                return nullptr;
+            return &chunks[next_chunk++];
+        }
+
+        /**
+         * \brief Passes the trees of \p chunk to \p callback
+         */
+        template<class Callback>
+            void deliver(Chunk& chunk, const Callback& callback)
+        {
+            std::size_t sequence = chunk.first;
+            for ( auto& tree : chunk.trees )
+            {
+                if ( stopped )
+                    break;
+                if ( !callback(sequence++, std::move(tree)) )
+                {
+                    callback_stopped = true;
+                    stop();
+                    break;
+                }
+            }
+            chunk.trees.clear();
+            chunk.trees.shrink_to_fit();
+        }
+
+        void stop()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopped = true;
+            condition.notify_all();
+        }
+
+        /**
+         * \brief Throws the error of the first failed chunk, if any
+         */
+        void rethrow()
+        {
+            for ( const auto& chunk : chunks )
+                if ( chunk.error )
+                    std::rethrow_exception(chunk.error);
+        }
+
+        std::vector<Record> records;
+        std::vector<Chunk> chunks;
+        std::string stream_name;
+        std::mutex mutex;                       ///< Guards the chunk progress
+        std::mutex callback_mutex;              ///< Serializes unordered callbacks
+        std::condition_variable condition;
+        std::size_t next_chunk = 0;             ///< Next chunk to be claimed
+        std::size_t delivered = 0;              ///< Number of delivered chunks
+        std::size_t window = 0;                 ///< Max chunks ahead of delivery, 0 for no limit
+        std::atomic<bool> stopped{false};       ///< Whether the threads should stop
+        bool callback_stopped = false;          ///< Whether the callback returned false
+        std::exception_ptr callback_error;      ///< Exception thrown by the callback
+    };
+
+    /**
+     * \brief Waits for chunks and delivers them in order
+     */
+    template<class Callback>
+        static void deliver_ordered(Job& job, const Callback& callback)
+    {
+        for ( auto& chunk : job.chunks )
+        {
+            {
+                std::unique_lock<std::mutex> lock(job.mutex);
+                job.condition.wait(lock, [&chunk]{ return chunk.done; });
+            }
+
+            job.deliver(chunk, callback);
+
+            std::lock_guard<std::mutex> lock(job.mutex);
+            if ( chunk.error || job.stopped )
+            {
+                // Later chunks aren't needed anymore
+                job.stopped = true;
+                job.condition.notify_all();
+                return;
+            }
+            job.delivered++;
+            job.condition.notify_all();
+        }
+    }
+
+    /**
+     * \brief Finds the non-blank lines
+     */
+    static std::vector<Record> split(const char* data, std::size_t size)
+    {
+        std::vector<Record> records;
+        const char* end = data + size;
+        std::size_t line = 1;
+        while ( data < end )
+        {
+            const char* newline = static_cast<const char*>(std::memchr(data, '\n', end - data));
+            if ( !newline )
+                newline = end;
+
+            if ( std::any_of(data, newline, [](char c){
+                    return c != ' ' && c != '\t' && c != '\r';
+                }) )
+                records.push_back(Record{data, std::size_t(newline - data), line});
+
+            data = newline + 1;
+            line++;
+        }
+        return records;
+    }
+
+    unsigned thread_count = 1;
+    std::size_t chunk_records = 256;
+    bool in_order = true;
+};
+
+} // namespace json
+} // namespace httpony
+#endif // HTTPONY_NDJSON_HPP
@@ -30,19 +30,26 @@
 #include <melanolib/utils/c++-compat.hpp>
 /// \endcond
 
+#include "httpony/util/arena.hpp"
+#include "httpony/util/escape.hpp"
+
 namespace httpony {
 namespace quick_xml {
 
+/**
+ * \brief Returns \p string with XML special characters escaped
+ */
 inline std::string amp_escape(const std::string& string)
 {
-    static const std::unordered_map<std::string, std::string> replacements{
-        {"\"", "&quot;"},
-        {"'", "&apos;"},
-        {"&", "&amp;"},
-        {"<", "&lt;"},
-        {">", "&gt;"}
-    };
-    return melanolib::string::replace(string, replacements);
+    return escape::xml(string);
+}
+
+/**
+ * \brief Writes \p string to \p out escaping XML special characters
+ */
+inline void amp_escape(std::ostream& out, const std::string& string)
+{
+    escape::xml(out, string);
 }
 
 class Indentation
@@ -107,6 +114,34 @@ private:
     int  level;
 };
 
+/**
+ * \brief Creates a node owned by a shared pointer
+ */
+template<class NodeT, class... Args>
+    std::shared_ptr<NodeT> make_node(Args&&... args)
+{
+    return std::make_shared<NodeT>(std::forward<Args>(args)...);
+}
+
+/**
+ * \brief Creates a node in \p arena, or owned by a shared pointer if
+ * \p arena is \b nullptr
+ *
+ * Nodes in the arena are destroyed with it, the shared pointers
+ * referring to them don't own them so they must not outlive the arena.
+ * Children the node creates for itself are not placed in the arena.
+ */
+template<class NodeT, class... Args>
+    std::shared_ptr<NodeT> make_arena_node(Arena* arena, Args&&... args)
+{
+    if ( arena )
+        return std::shared_ptr<NodeT>(
+            std::shared_ptr<void>(),
+            arena->create<NodeT>(std::forward<Args>(args)...)
+        );
+    return make_node<NodeT>(std::forward<Args>(args)...);
+}
+
 class Node
 {
 public:
@@ -152,7 +187,7 @@ protected:
         NodeT& append(NodeT&& child)
         {
             return append(
-                std::make_shared<std::remove_cv_t<std::remove_reference_t<NodeT>>>(
+                make_node<std::remove_cv_t<std::remove_reference_t<NodeT>>>(
                     std::forward<NodeT>(child)
             ));
         }
@@ -295,7 +330,9 @@ public:
     void print(std::ostream& out, const Indentation& indent) const override
     {
         indent.indent(out, Indentation::Attribute);
-        out << _name << "=\"" << amp_escape(_value) << '\"';
+        out << _name << "=\"";
+        amp_escape(out, _value);
+        out << '\"';
     }
 
     bool is_attribute() const override
@@ -351,7 +388,7 @@ public:
 
     void print(std::ostream& out, const Indentation& indent) const override
     {
-        out << amp_escape(_contents);
+        amp_escape(out, _contents);
     }
 
 private:
@@ -473,16 +510,28 @@ class HtmlDocument : public Node
 {
 public:
     HtmlDocument(std::string title, BlockElement body = BlockElement{"body"})
+        : HtmlDocument(nullptr, std::move(title), std::move(body))
+    {}
+
+    /**
+     * \brief Creates a document which allocates its nodes from its own arena
+     *
+     * Nodes created with make() are placed in the arena as well,
+     * they are all freed at once when the document is destroyed.
+     */
+    static HtmlDocument with_arena(std::string title,
+                                   BlockElement body = BlockElement{"body"},
+                                   std::size_t block_size = 4096)
     {
-        auto shared_title = std::make_shared<Text>(std::move(title));
-        _title = shared_title.get();
-        auto shared_head = std::make_shared<BlockElement>("head", BlockElement{"title", shared_title});
-        _head = shared_head.get();
-        auto shared_body = std::make_shared<BlockElement>(std::move(body));
-        _body = shared_body.get();
-        append(DocType{"html"}, BlockElement{"html", shared_head, shared_body});
+        return HtmlDocument(
+            melanolib::New<Arena>(block_size),
+            std::move(title),
+            std::move(body)
+        );
     }
 
+    HtmlDocument(HtmlDocument&&) = default;
+
     std::string title() const
     {
         return _title->contents();
@@ -503,10 +552,44 @@ public:
         return *_body;
     }
 
+    /**
+     * \brief Arena owned by the document, if any
+     */
+    Arena* arena() const
+    {
+        return _arena.get();
+    }
+
+    /**
+     * \brief Creates a node in the document arena (if any)
+     *
+     * The node must only be added to this document, as it's destroyed
+     * along with it.
+     */
+    template<class NodeT, class... Args>
+        std::shared_ptr<NodeT> make(Args&&... args) const
+    {
+        return make_arena_node<NodeT>(_arena.get(), std::forward<Args>(args)...);
+    }
+
 private:
+    HtmlDocument(std::unique_ptr<Arena> arena, std::string title, BlockElement body)
+        : _arena(std::move(arena))
+    {
+        auto shared_title = make<Text>(std::move(title));
+        _title = shared_title.get();
+        auto shared_head = make<BlockElement>("head", BlockElement{"title", shared_title});
+        _head = shared_head.get();
+        auto shared_body = make<BlockElement>(std::move(body));
+        _body = shared_body.get();
+        append(DocType{"html"}, BlockElement{"html", shared_head, shared_body});
+    }
+
     Text* _title;
     BlockElement* _head;
     BlockElement* _body;
+    /// Declared last so arena nodes are destroyed before anything else
+    std::unique_ptr<Arena> _arena;
 };
 
 class List : public BlockElement
@@ -527,7 +610,7 @@ public:
     std::enable_if_t<std::is_base_of<Node, std::decay_t<ElemT>>::value, std::decay_t<ElemT>&>
     add_item(ElemT&& element)
     {
-        auto shared = std::make_shared<std::decay_t<ElemT>>(std::forward<ElemT>(element));
+        auto shared = make_node<std::decay_t<ElemT>>(std::forward<ElemT>(element));
         return add_item<std::decay_t<ElemT>>(shared);
     }
 };
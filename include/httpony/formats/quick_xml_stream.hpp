@@ -0,0 +1,355 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef HTTPONY_QUICK_XML_STREAM_HPP
+#define HTTPONY_QUICK_XML_STREAM_HPP
+
+/// \cond
+#include <stdexcept>
+/// \endcond
+
+#include "httpony/formats/quick_xml.hpp"
+
+namespace httpony {
+namespace quick_xml {
+
+/**
+ * \brief Writes markup directly to a stream as it's being generated
+ *
+ * The output and indentation are the same as printing the equivalent
+ * tree of Node objects, but no tree is built.
+ *
+ * Elements are opened with element() or block_element(), which return a
+ * Scope that closes them when destroyed. Attributes can be added to the
+ * innermost element until any content is written into it.
+ */
+class XmlWriter
+{
+public:
+    /**
+     * \brief Closes elements when it goes out of scope
+     */
+    class Scope
+    {
+    public:
+        Scope(Scope&& other)
+            : writer(other.writer),
+              depth(other.depth)
+        {
+            other.writer = nullptr;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        ~Scope()
+        {
+            close();
+        }
+
+        /**
+         * \brief Closes the element and any element still open inside it
+         */
+        void close()
+        {
+            if ( writer )
+            {
+                while ( writer->depth() > depth )
+                    writer->close();
+                writer = nullptr;
+            }
+        }
+
+    private:
+        Scope(XmlWriter* writer, std::size_t depth)
+            : writer(writer),
+              depth(depth)
+        {}
+
+        XmlWriter* writer;
+        std::size_t depth;
+
+        friend class XmlWriter;
+    };
+
+    explicit XmlWriter(std::ostream& out, const Indentation& indent = Indentation())
+        : out(out),
+          root_indent(indent)
+    {}
+
+    XmlWriter(const XmlWriter&) = delete;
+    XmlWriter& operator=(const XmlWriter&) = delete;
+
+    /**
+     * \brief Opens an element which is self-closed if it has no contents
+     * (like Element)
+     */
+    template<class... Attrs>
+        Scope element(const std::string& tag_name, Attrs&&... attributes)
+    {
+        return open_scope(tag_name, false, std::forward<Attrs>(attributes)...);
+    }
+
+    /**
+     * \brief Opens an element which always has a closing tag
+     * (like BlockElement)
+     */
+    template<class... Attrs>
+        Scope block_element(const std::string& tag_name, Attrs&&... attributes)
+    {
+        return open_scope(tag_name, true, std::forward<Attrs>(attributes)...);
+    }
+
+    /**
+     * \brief Opens an element, it must be closed explicitly with close()
+     */
+    void open(const std::string& tag_name, bool block = true)
+    {
+        start_child(true);
+        Indentation indent = child_indent();
+        indent.indent(out);
+        out << '<' << tag_name;
+        stack.push_back(Frame{tag_name, indent, block});
+    }
+
+    /**
+     * \brief Closes the innermost open element
+     */
+    void close()
+    {
+        if ( stack.empty() )
+            throw std::logic_error("No element to close");
+
+        Frame& frame = stack.back();
+        if ( frame.start_tag_open && !frame.block )
+        {
+            out << "/>";
+        }
+        else
+        {
+            end_start_tag();
+            if ( frame.has_element )
+                frame.indent.indent(out);
+            out << "</" << frame.tag_name << '>';
+        }
+        stack.pop_back();
+    }
+
+    /**
+     * \brief Adds an attribute to the innermost open element
+     * \throws std::logic_error if the element already has contents
+     */
+    XmlWriter& attribute(const std::string& name, const std::string& value)
+    {
+        if ( stack.empty() || !stack.back().start_tag_open )
+            throw std::logic_error("Attributes must precede the element contents");
+        stack.back().indent.next().indent(out, Indentation::Attribute);
+        out << name << "=\"";
+        amp_escape(out, value);
+        out << '"';
+        stack.back().has_attribute = true;
+        return *this;
+    }
+
+    XmlWriter& attribute(const Attribute& attribute)
+    {
+        return this->attribute(attribute.name(), attribute.value());
+    }
+
+    /**
+     * \brief Writes escaped text
+     */
+    XmlWriter& text(const std::string& contents)
+    {
+        start_child(false);
+        amp_escape(out, contents);
+        return *this;
+    }
+
+    /**
+     * \brief Writes markup as it is
+     */
+    XmlWriter& raw(const std::string& contents)
+    {
+        start_child(false);
+        out << contents;
+        return *this;
+    }
+
+    XmlWriter& comment(const std::string& contents)
+    {
+        return node(Comment(contents));
+    }
+
+    XmlWriter& doctype(const std::string& string)
+    {
+        return node(DocType(string));
+    }
+
+    XmlWriter& xml_declaration(const std::string& version = "1.0",
+                               const std::string& encoding = "utf-8")
+    {
+        return node(XmlDeclaration(version, encoding));
+    }
+
+    /**
+     * \brief Prints a pre-built node as a child of the innermost open element
+     */
+    XmlWriter& node(const Node& node)
+    {
+        if ( node.is_attribute() )
+        {
+            if ( stack.empty() || !stack.back().start_tag_open )
+                throw std::logic_error("Attributes must precede the element contents");
+            node.print(out, stack.back().indent.next());
+            stack.back().has_attribute = true;
+        }
+        else
+        {
+            start_child(node.is_element());
+            node.print(out, child_indent());
+        }
+        return *this;
+    }
+
+    /**
+     * \brief Number of open elements
+     */
+    std::size_t depth() const
+    {
+        return stack.size();
+    }
+
+private:
+    struct Frame
+    {
+        std::string tag_name;
+        Indentation indent;
+        bool block;
+        bool start_tag_open = true;
+        bool has_attribute = false;
+        bool has_element = false;
+
+        Frame(std::string tag_name, Indentation indent, bool block)
+            : tag_name(std::move(tag_name)), indent(indent), block(block)
+        {}
+    };
+
+    template<class... Attrs>
+        Scope open_scope(const std::string& tag_name, bool block, Attrs&&... attributes)
+    {
+        std::size_t depth = stack.size();
+        open(tag_name, block);
+        using swallow = int[];
+        (void)swallow{0, (attribute(std::forward<Attrs>(attributes)), 0)...};
+        return Scope(this, depth);
+    }
+
+    Indentation child_indent() const
+    {
+        return stack.empty() ? root_indent : stack.back().indent.next();
+    }
+
+    /**
+     * \brief Terminates the start tag of the innermost element if needed
+     */
+    void end_start_tag()
+    {
+        Frame& frame = stack.back();
+        if ( !frame.start_tag_open )
+            return;
+        if ( frame.has_attribute && frame.indent.indents_attributes() )
+            frame.indent.indent(out);
+        out << '>';
+        frame.start_tag_open = false;
+    }
+
+    /**
+     * \brief Prepares the innermost element to receive a child
+     */
+    void start_child(bool is_element)
+    {
+        if ( stack.empty() )
+            return;
+        end_start_tag();
+        if ( is_element )
+            stack.back().has_element = true;
+    }
+
+    std::ostream& out;
+    Indentation root_indent;
+    std::vector<Frame> stack;
+};
+
+namespace html {
+
+/**
+ * \brief Streaming counterpart of HtmlDocument
+ *
+ * The constructor writes everything up to the opening body tag,
+ * the remaining elements are closed when the writer is destroyed
+ * or finish() is called.
+ */
+class HtmlWriter : public XmlWriter
+{
+public:
+    HtmlWriter(std::ostream& out, const std::string& title, const Indentation& indent = Indentation())
+        : XmlWriter(out, indent)
+    {
+        doctype("html");
+        open("html");
+        {
+            auto head = block_element("head");
+            auto title_element = block_element("title");
+            text(title);
+        }
+        open("body");
+    }
+
+    ~HtmlWriter()
+    {
+        finish();
+    }
+
+    /**
+     * \brief Closes all open elements
+     */
+    void finish()
+    {
+        while ( depth() )
+            close();
+    }
+
+    /**
+     * \brief Writes a link with text contents
+     */
+    HtmlWriter& link(const std::string& target, const std::string& text)
+    {
+        auto anchor = block_element("a", Attribute{"href", target});
+        this->text(text);
+        return *this;
+    }
+};
+
+} // namespace html
+
+} // namespace quick_xml
+} // namespace httpony
+#endif // HTTPONY_QUICK_XML_STREAM_HPP
@@ -0,0 +1,365 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef HTTPONY_QUICK_XML_TEMPLATE_HPP
+#define HTTPONY_QUICK_XML_TEMPLATE_HPP
+
+/// \cond
+#include <limits>
+#include <stdexcept>
+#include <streambuf>
+#include <unordered_map>
+
+#include <boost/asio/buffer.hpp>
+/// \endcond
+
+#include "httpony/formats/quick_xml.hpp"
+
+namespace httpony {
+namespace quick_xml {
+
+namespace detail {
+
+    /**
+     * \brief Stream buffer which splits printed markup at slots
+     */
+    class TemplateBuffer : public std::streambuf
+    {
+    public:
+        enum class SlotType
+        {
+            Text,   ///< Value is escaped
+            Raw,    ///< Value is written as it is
+        };
+
+        struct Segment
+        {
+            std::string markup;     ///< Static markup preceding the slot
+            std::size_t slot;       ///< Index of the slot, or npos for the last segment
+        };
+
+        static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+        /**
+         * \brief Ends the current static run with a slot
+         */
+        void add_slot(const std::string& name, SlotType type)
+        {
+            auto iter = slot_index.find(name);
+            std::size_t index;
+            if ( iter == slot_index.end() )
+            {
+                index = slot_types.size();
+                slot_index.emplace(name, index);
+                slot_types.push_back(type);
+            }
+            else
+            {
+                index = iter->second;
+                if ( slot_types[index] != type )
+                    throw std::logic_error("Slot " + name + " used with different types");
+            }
+            segments.push_back(Segment{std::move(current), index});
+            current.clear();
+        }
+
+        /**
+         * \brief Terminates the last static run
+         */
+        void finish()
+        {
+            segments.push_back(Segment{std::move(current), npos});
+            current.clear();
+        }
+
+        std::vector<Segment> segments;
+        std::unordered_map<std::string, std::size_t> slot_index;
+        std::vector<SlotType> slot_types;
+
+    protected:
+        int_type overflow(int_type ch) override
+        {
+            if ( !traits_type::eq_int_type(ch, traits_type::eof()) )
+                current.push_back(traits_type::to_char_type(ch));
+            return traits_type::not_eof(ch);
+        }
+
+        std::streamsize xsputn(const char* data, std::streamsize size) override
+        {
+            current.append(data, size);
+            return size;
+        }
+
+    private:
+        std::string current;
+    };
+
+    /**
+     * \brief Returns the template buffer \p out is writing to, if any
+     */
+    inline TemplateBuffer* template_buffer(std::ostream& out)
+    {
+        return dynamic_cast<TemplateBuffer*>(out.rdbuf());
+    }
+
+} // namespace detail
+
+/**
+ * \brief Placeholder for text filled in when rendering a Template
+ *
+ * When printed outside a template it shows its default contents.
+ */
+class Slot : public Node
+{
+public:
+    /**
+     * \param name      Name used to fill the slot
+     * \param contents  Text shown when printed outside a template
+     * \param escape    Whether the value is escaped or inserted as markup
+     */
+    explicit Slot(std::string name, std::string contents = {}, bool escape = true)
+        : _name(std::move(name)),
+          _contents(std::move(contents)),
+          _escape(escape)
+    {}
+
+    std::string name() const
+    {
+        return _name;
+    }
+
+    void print(std::ostream& out, const Indentation& indent) const override
+    {
+        if ( auto buffer = detail::template_buffer(out) )
+        {
+            out.flush();
+            buffer->add_slot(_name, _escape ?
+                detail::TemplateBuffer::SlotType::Text :
+                detail::TemplateBuffer::SlotType::Raw
+            );
+        }
+        else if ( _escape )
+        {
+            amp_escape(out, _contents);
+        }
+        else
+        {
+            out << _contents;
+        }
+    }
+
+private:
+    std::string _name;
+    std::string _contents;
+    bool _escape;
+};
+
+/**
+ * \brief Attribute with a value filled in when rendering a Template
+ */
+class AttributeSlot : public Node
+{
+public:
+    /**
+     * \param name      Attribute name
+     * \param slot_name Name used to fill the slot
+     * \param value     Value shown when printed outside a template
+     */
+    AttributeSlot(std::string name, std::string slot_name, std::string value = {})
+        : _name(std::move(name)),
+          _slot(std::move(slot_name), std::move(value))
+    {}
+
+    std::string name() const
+    {
+        return _name;
+    }
+
+    void print(std::ostream& out, const Indentation& indent) const override
+    {
+        indent.indent(out, Indentation::Attribute);
+        out << _name << "=\"";
+        _slot.print(out, indent);
+        out << '\"';
+    }
+
+    bool is_attribute() const override
+    {
+        return true;
+    }
+
+private:
+    std::string _name;
+    Slot _slot;
+};
+
+/**
+ * \brief Markup prerendered into static runs and slots
+ *
+ * A template is compiled once from a tree containing Slot and AttributeSlot
+ * nodes, rendering it only copies the static runs and the slot values.
+ */
+class Template
+{
+public:
+    /**
+     * \brief Slot values for a single rendering
+     *
+     * Values are escaped when they are set, so they can be rendered
+     * multiple times without further processing
+     */
+    class Values
+    {
+    public:
+        explicit Values(const Template& owner)
+            : owner(&owner),
+              values(owner.slot_count())
+        {}
+
+        /**
+         * \throws std::out_of_range If the template has no such slot
+         */
+        Values& set(const std::string& name, const std::string& value)
+        {
+            return set(owner->slot(name), value);
+        }
+
+        Values& set(std::size_t index, const std::string& value)
+        {
+            if ( owner->buffer.slot_types.at(index) == detail::TemplateBuffer::SlotType::Text )
+                values[index] = amp_escape(value);
+            else
+                values[index] = value;
+            return *this;
+        }
+
+        /**
+         * \brief Value as it will be rendered
+         */
+        const std::string& operator[](std::size_t index) const
+        {
+            return values[index];
+        }
+
+    private:
+        const Template* owner;
+        std::vector<std::string> values;
+    };
+
+    /**
+     * \brief Compiles \p node, printing it with the given indentation
+     */
+    explicit Template(const Node& node, const Indentation& indent = Indentation())
+    {
+        std::ostream out(&buffer);
+        node.print(out, indent);
+        out.flush();
+        buffer.finish();
+
+        for ( const auto& segment : buffer.segments )
+            static_size += segment.markup.size();
+    }
+
+    Template(const Template&) = delete;
+    Template& operator=(const Template&) = delete;
+
+    /**
+     * \brief Creates an empty set of values for this template
+     */
+    Values values() const
+    {
+        return Values(*this);
+    }
+
+    /**
+     * \brief Index of the slot with the given name
+     * \throws std::out_of_range If there's no such slot
+     */
+    std::size_t slot(const std::string& name) const
+    {
+        return buffer.slot_index.at(name);
+    }
+
+    std::size_t slot_count() const
+    {
+        return buffer.slot_types.size();
+    }
+
+    /**
+     * \brief Writes the template to \p out
+     */
+    void render(std::ostream& out, const Values& values) const
+    {
+        for ( const auto& segment : buffer.segments )
+        {
+            out.write(segment.markup.data(), segment.markup.size());
+            if ( segment.slot != detail::TemplateBuffer::npos )
+                out.write(values[segment.slot].data(), values[segment.slot].size());
+        }
+    }
+
+    /**
+     * \brief Renders the template as a string
+     */
+    std::string render(const Values& values) const
+    {
+        std::size_t size = static_size;
+        for ( std::size_t i = 0; i < slot_count(); i++ )
+            size += values[i].size();
+
+        std::string result;
+        result.reserve(size);
+        for ( const auto& segment : buffer.segments )
+        {
+            result += segment.markup;
+            if ( segment.slot != detail::TemplateBuffer::npos )
+                result += values[segment.slot];
+        }
+        return result;
+    }
+
+    /**
+     * \brief Renders the template as a list of buffers for a gather write
+     *
+     * The buffers refer to data owned by the template and by \p values,
+     * both must outlive the returned list.
+     */
+    std::vector<boost::asio::const_buffer> gather(const Values& values) const
+    {
+        std::vector<boost::asio::const_buffer> result;
+        result.reserve(buffer.segments.size() * 2);
+        for ( const auto& segment : buffer.segments )
+        {
+            if ( !segment.markup.empty() )
+                result.push_back(boost::asio::buffer(segment.markup));
+            if ( segment.slot != detail::TemplateBuffer::npos && !values[segment.slot].empty() )
+                result.push_back(boost::asio::buffer(values[segment.slot]));
+        }
+        return result;
+    }
+
+private:
+    detail::TemplateBuffer buffer;
+    std::size_t static_size = 0;
+};
+
+} // namespace quick_xml
+} // namespace httpony
+#endif // HTTPONY_QUICK_XML_TEMPLATE_HPP
@@ -30,6 +30,7 @@
 /// \endcond
 
 #include "httpony/io/basic_client.hpp"
+#include "httpony/http/cookie_jar.hpp"
 #include "httpony/http/response.hpp"
 
 namespace httpony {
@@ -150,6 +151,19 @@ public:
         set_max_response_size(io::NetworkInputBuffer::unlimited_input());
     }
 
+    /**
+     * \brief Cookies received from the servers, sent back on matching requests
+     */
+    ClientCookieJar& cookie_jar()
+    {
+        return _cookie_jar;
+    }
+
+    const ClientCookieJar& cookie_jar() const
+    {
+        return _cookie_jar;
+    }
+
 protected:
     /**
      * \brief Called right before a request is sent to the connection
@@ -191,6 +205,7 @@ private:
 
     io::BasicClient _basic_client;
     UserAgent _user_agent;
+    ClientCookieJar _cookie_jar;
     int _max_redirects = 0;
     std::size_t _max_response_size = io::NetworkInputBuffer::unlimited_input();
 };
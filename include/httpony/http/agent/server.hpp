@@ -27,6 +27,7 @@
 /// \endcond
 
 #include "httpony/io/basic_server.hpp"
+#include "httpony/ip_access_list.hpp"
 #include "httpony/http/response.hpp"
 
 namespace httpony {
@@ -110,6 +111,43 @@ public:
 
     std::size_t max_request_size() const;
 
+    /**
+     * \brief Addresses allowed to connect
+     *
+     * Checked for every connection before accept() is called
+     */
+    IPAccessList& access_list()
+    {
+        return _access_list;
+    }
+
+    const IPAccessList& access_list() const
+    {
+        return _access_list;
+    }
+
+    /**
+     * \brief Memory limit shared by all the connections of this server
+     *
+     * Request bodies are charged to the budget as soon as their headers
+     * are parsed, if they don't fit the suggested response is
+     * 503 (Service Unavailable).
+     * Response bodies are charged by send() until they have been written,
+     * if they don't fit a 503 without a body is sent instead.
+     * Connections marked by the Shed policy are closed instead of being
+     * answered.
+     * Only connections handled outside the listening thread (such as by
+     * BasicPooledServer) wait for memory.
+     */
+    io::MemoryBudget& memory_budget()
+    {
+        return _memory_budget;
+    }
+
+    const io::MemoryBudget& memory_budget() const
+    {
+        return _memory_budget;
+    }
 
     /**
      * \brief Function handling requests
@@ -162,6 +200,7 @@ private:
      * \brief Whether to accept the incoming connection
      *
      * At this stage no data has been read from \p connection
+     * and its address has already been checked against access_list()
      */
     virtual OperationStatus accept(io::Connection& connection)
     {
@@ -185,9 +224,14 @@ private:
 
     IPAddress _connect_address;
     IPAddress _listen_address;
+    // Declared before _listen_server, it must outlive the connections
+    io::MemoryBudget _memory_budget;
     io::BasicServer _listen_server;
     std::size_t _max_request_size = io::NetworkInputBuffer::unlimited_input();
     std::thread _thread;
+    /// Thread accepting connections, it never waits for the memory budget
+    std::thread::id _listen_thread;
+    IPAccessList _access_list;
 };
 
 /**
@@ -284,10 +328,10 @@ private:
             if ( !running[index] )
             {
                 running[index] = true;
-                auto connection = queue.front();
+                auto connection = std::move(queue.front());
                 queue.pop();
-                thread = std::thread([this, connection, index]() {
-                    thread_run(index, connection);
+                thread = std::thread([this, connection = std::move(connection), index]() mutable {
+                    thread_run(index, std::move(connection));
                 });
 
                 if ( queue.empty() )
@@ -358,7 +402,7 @@ private:
                 std::unique_lock<std::mutex> lock(mutex_queue, std::try_to_lock);
                 if ( lock.owns_lock() && !pause && !queue.empty() )
                 {
-                    connection = queue.front();
+                    connection = std::move(queue.front());
                     queue.pop();
                     thread_continue(thread_index, connection);
                     continue;
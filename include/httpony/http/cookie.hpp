@@ -84,7 +84,7 @@ struct Cookie
      */
     bool matches_uri(const Uri& uri) const
     {
-        return matches_domain(uri.authority.host) && matches_path(path);
+        return matches_domain(uri.authority.host) && matches_path(uri.path);
     }
 
     /**
@@ -178,12 +178,5 @@ inline std::ostream& operator<<(std::ostream& os, CookieJar::const_reference coo
 }
 
 
-/**
- * \todo Order as from https://tools.ietf.org/html/rfc6265#section-5.4 (2.)
- */
-using ClientCookieJar = CookieJar;
-
-
-
 } // namespace httpony
 #endif // HTTPONT_COOKIE_HPP
@@ -0,0 +1,139 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef HTTPONY_HTTP_COOKIE_JAR_HPP
+#define HTTPONY_HTTP_COOKIE_JAR_HPP
+
+/// \cond
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+/// \endcond
+
+#include "httpony/http/cookie.hpp"
+
+namespace httpony {
+
+/**
+ * \brief Cookies received by a client, to be sent back with later requests
+ *
+ * Cookies are grouped by registrable domain (the public suffix and one
+ * more label of the host name) and then by path, so finding the cookies for
+ * a request only looks at the cookies for its domain and the prefixes of
+ * its path.
+ *
+ * Public suffixes are the top level domains and a built-in list of common
+ * multi-label suffixes (such as co.uk), cookies can't be set for them.
+ *
+ * All member functions can be called from multiple threads.
+ * \see https://tools.ietf.org/html/rfc6265#section-5.3
+ */
+class ClientCookieJar
+{
+public:
+    ClientCookieJar() = default;
+    ClientCookieJar(const ClientCookieJar&) = delete;
+    ClientCookieJar& operator=(const ClientCookieJar&) = delete;
+
+    /**
+     * \brief Stores the cookies from a response to a request for \p uri
+     */
+    void store(
+        const Uri& uri,
+        const CookieJar& cookies,
+        const melanolib::time::DateTime& now = {}
+    );
+
+    /**
+     * \brief Stores a cookie from a response to a request for \p uri
+     * \returns \b false if the cookie has been rejected
+     */
+    bool store(
+        const Uri& uri,
+        const std::string& name,
+        Cookie cookie,
+        const melanolib::time::DateTime& now = {}
+    );
+
+    /**
+     * \brief Adds the cookies to send with a request for \p uri to \p output
+     *
+     * Cookies with longer paths come first, cookies whose name is already
+     * in \p output are skipped.
+     */
+    void select(
+        const Uri& uri,
+        DataMap& output,
+        const melanolib::time::DateTime& now = {}
+    ) const;
+
+    /**
+     * \brief Removes all the expired cookies
+     */
+    void remove_expired(const melanolib::time::DateTime& now = {});
+
+    void clear();
+
+    /**
+     * \brief Number of stored cookies
+     */
+    std::size_t size() const;
+
+private:
+    struct Entry
+    {
+        std::string name;
+        Cookie cookie;
+        bool host_only;
+    };
+
+    /// Cookies for a registrable domain, indexed by path
+    using PathIndex = std::unordered_map<std::string, std::vector<Entry>>;
+
+    /**
+     * \brief Key used to group hosts sharing cookies
+     */
+    static std::string registrable_domain(const std::string& host);
+
+    /**
+     * \brief Whether cookies for \p domain would be shared by unrelated sites
+     */
+    static bool is_public_suffix(const std::string& domain);
+
+    /**
+     * \brief Position in \p host where its public suffix starts
+     */
+    static std::size_t public_suffix_start(const std::string& host);
+
+    /**
+     * \brief Removes the expired cookies in \p index
+     * \pre \p mutex is locked for writing
+     */
+    void remove_expired(PathIndex& index, const melanolib::time::DateTime& now);
+
+    std::unordered_map<std::string, PathIndex> domains;
+    std::size_t count = 0;
+    mutable std::shared_timed_mutex mutex;
+};
+
+} // namespace httpony
+#endif // HTTPONY_HTTP_COOKIE_JAR_HPP
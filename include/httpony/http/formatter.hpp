@@ -55,6 +55,11 @@ public:
         : endl(std::move(line_ending))
     {}
 
+    const std::string& line_ending() const
+    {
+        return endl;
+    }
+
     /**
      * \brief Writes the entire response to the stream
      * \note \p response is passed by non-const reference because
@@ -68,10 +73,18 @@ public:
     }
 
     void request(std::ostream& stream, Request& request) const override
+    {
+        request_head(stream, request);
+        request.body.write_to(stream);
+    }
+
+    /**
+     * \brief Writes the request line and headers, without the body
+     */
+    void request_head(std::ostream& stream, const Request& request) const
     {
         request_line(stream, request);
         request_headers(stream, request);
-        request.body.write_to(stream);
     }
 
     /**
@@ -143,7 +156,7 @@ private:
                << response.status.message << endl;
     }
 
-    void request_line(std::ostream& stream, Request& request) const
+    void request_line(std::ostream& stream, const Request& request) const
     {
         stream << request.method << ' ' << request.uri.path.url_encoded(true)
                << request.uri.query_string(true) << ' ' << request.protocol << endl;
@@ -206,6 +206,13 @@ public:
 
     bool auth(const std::string& header_contents, Auth& auth) const;
 
+    /**
+     * \brief Parses the value of a Set-Cookie header
+     * \see https://tools.ietf.org/html/rfc6265#section-5.2
+     * \returns \b true on success
+     */
+    bool set_cookie(const std::string& header_value, std::string& name, Cookie& cookie) const;
+
 private:
     /**
      * \brief Reads a string delimited by a specific character and ignores following spaces
@@ -33,6 +33,12 @@ namespace post {
  */
 class FormData final : public PostFormat
 {
+public:
+    std::vector<std::string> parsed_types() const override
+    {
+        return {"multipart/form-data"};
+    }
+
 private:
     bool do_can_parse(const Request& request) const override
     {
@@ -97,17 +103,20 @@ private:
         /// \todo Change formatter based on the protocol
         Http1Formatter formatter;
 
-        Multipart form_data(boundary);
-        form_data.parts.reserve(request.post.size());
+        // Parts are written directly instead of going through Multipart
+        // so their contents don't get copied more than needed
         for ( const auto& item: request.post )
         {
             CompoundHeader disposition;
             disposition.value = "form-data";
             disposition.parameters["name"] = item.first;
-            form_data.parts.push_back({
+            write_part(
+                request.body,
+                formatter,
+                boundary,
                 {{"Content-Disposition", formatter.compound_header(disposition)}},
                 item.second
-            });
+            );
         }
 
         for ( const auto& item: request.files )
@@ -122,10 +131,10 @@ private:
                 {{"name", item.first}, {"filename", item.second.filename}}
             });
 
-            form_data.parts.push_back({part_headers, item.second.contents});
+            write_part(request.body, formatter, boundary, part_headers, item.second.contents);
         }
 
-        formatter.multipart(request.body, form_data);
+        request.body << formatter.line_ending() << "--" << boundary << "--" << formatter.line_ending();
         return true;
     }
 
@@ -151,6 +160,38 @@ private:
         return boundary;
     }
 
+    /**
+     * \brief Writes a part of the multipart data, the same as Http1Formatter::multipart()
+     *
+     * Large contents are referenced by the body rather than copied,
+     * so they must not be modified until the request has been sent.
+     */
+    static void write_part(
+        io::ContentStream& body,
+        const Http1Formatter& formatter,
+        const std::string& boundary,
+        const Headers& headers,
+        const std::string& contents
+    )
+    {
+        body << formatter.line_ending() << "--" << boundary << formatter.line_ending();
+        formatter.headers(body, headers);
+        body << formatter.line_ending();
+
+        if ( contents.size() < reference_size )
+            body.write(contents.data(), contents.size());
+        else
+            body.output().write_reference(contents);
+    }
+
+    /**
+     * \brief Minimum size of the contents of a part to avoid copying it
+     *
+     * Small strings might be stored inside the string object,
+     * so they would be invalidated when the request is moved.
+     */
+    static constexpr std::size_t reference_size = 1024;
+
     /**
      * \brief Returns a character that is different from the input
      */
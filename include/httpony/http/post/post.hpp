@@ -22,6 +22,10 @@
 #define HTTPONY_HTTP_POST_POST_HPP
 
 /// \cond
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
 #include <melanolib/utils/singleton.hpp>
 /// \endcond
 
@@ -81,6 +85,18 @@ public:
         return do_format(request);
     }
 
+    /**
+     * \brief Content types (as "type/subtype") handled by parse()
+     *
+     * FormatRegistry uses them to select the format without calling
+     * can_parse() on each one, formats which return an empty list are
+     * queried with can_parse().
+     */
+    virtual std::vector<std::string> parsed_types() const
+    {
+        return {};
+    }
+
 private:
 
     /**
@@ -106,50 +122,61 @@ private:
     virtual bool do_format(Request& request) const = 0;
 };
 
+/**
+ * \brief Collection of formats used by Request to handle its payload
+ *
+ * Parsing selects the format by looking up the content type among the
+ * parsed_types() of the registered formats, the first format registered
+ * for a given type wins. Formats without parsed_types() are checked in
+ * order of registration after that.
+ *
+ * The default formats are loaded the first time the registry is used,
+ * unless other formats have been registered before that.
+ */
 class FormatRegistry : public melanolib::Singleton<FormatRegistry>
 {
 public:
     void register_format(std::unique_ptr<PostFormat>&& format)
     {
+        std::unique_lock<std::shared_timed_mutex> lock(mutex);
+        PostFormat* pointer = format.get();
         formats.emplace_back(std::move(format));
+
+        auto types = pointer->parsed_types();
+        if ( types.empty() )
+            unindexed.push_back(pointer);
+        for ( const auto& type : types )
+            parsers.emplace(type, pointer);
     }
 
     template<class Format, class... Args>
         void register_format(Args&&... args)
     {
-        formats.emplace_back(melanolib::New<Format>(std::forward<Args>(args)...));
+        register_format(melanolib::New<Format>(std::forward<Args>(args)...));
     }
 
     void load_default();
 
     bool can_parse(const Request& request)
     {
-        if ( formats.empty() )
-            load_default();
-
-        for ( const auto& format : formats )
-            if ( format->can_parse(request) )
-                return true;
-
-        return false;
+        load_default_once();
+        std::shared_lock<std::shared_timed_mutex> lock(mutex);
+        return find_parser(request);
     }
 
     bool parse(Request& request)
     {
-        if ( formats.empty() )
-            load_default();
-
-        for ( const auto& format : formats )
-            if ( format->can_parse(request) )
-                return format->parse(request);
-
+        load_default_once();
+        std::shared_lock<std::shared_timed_mutex> lock(mutex);
+        if ( PostFormat* format = find_parser(request) )
+            return format->parse(request);
         return false;
     }
 
     bool can_format(const Request& request)
     {
-        if ( formats.empty() )
-            load_default();
+        load_default_once();
+        std::shared_lock<std::shared_timed_mutex> lock(mutex);
 
         for ( const auto& format : formats )
             if ( format->can_format(request) )
@@ -160,8 +187,8 @@ public:
 
     bool format(Request& request)
     {
-        if ( formats.empty() )
-            load_default();
+        load_default_once();
+        std::shared_lock<std::shared_timed_mutex> lock(mutex);
 
         for ( const auto& format : formats )
             if ( format->can_format(request) )
@@ -174,7 +201,48 @@ private:
     FormatRegistry(){}
     friend ParentSingleton;
 
+    /**
+     * \brief Loads the default formats if nothing has been registered yet,
+     * safe to call from multiple threads
+     */
+    void load_default_once()
+    {
+        std::call_once(defaults_flag, [this]{
+            bool empty;
+            {
+                std::shared_lock<std::shared_timed_mutex> lock(mutex);
+                empty = formats.empty();
+            }
+            if ( empty )
+                load_default();
+        });
+    }
+
+    /**
+     * \brief Finds the format which can parse the request
+     * \pre \p mutex is locked
+     */
+    PostFormat* find_parser(const Request& request) const
+    {
+        if ( !request.body.has_input() )
+            return nullptr;
+
+        auto iter = parsers.find(request.body.content_type().name());
+        if ( iter != parsers.end() )
+            return iter->second;
+
+        for ( PostFormat* format : unindexed )
+            if ( format->can_parse(request) )
+                return format;
+
+        return nullptr;
+    }
+
     std::vector<std::unique_ptr<PostFormat>> formats;
+    std::unordered_map<std::string, PostFormat*> parsers;   ///< Formats by parsed type
+    std::vector<PostFormat*> unindexed;                     ///< Formats without parsed_types()
+    mutable std::shared_timed_mutex mutex;
+    std::once_flag defaults_flag;
 };
 
 } // namespace post
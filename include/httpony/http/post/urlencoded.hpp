@@ -29,6 +29,12 @@ namespace post {
 
 class UrlEncoded final : public PostFormat
 {
+public:
+    std::vector<std::string> parsed_types() const override
+    {
+        return {"application/x-www-form-urlencoded"};
+    }
+
 private:
     bool do_can_parse(const Request& request) const override
     {
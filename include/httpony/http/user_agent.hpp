@@ -22,14 +22,18 @@
 #define HTTPONY_HTTP_USER_AGENT_HPP
 
 /// \cond
+#include <algorithm>
+#include <memory>
 #include <vector>
 #include <string>
 #include <ostream>
 #include <melanolib/string/quickstream.hpp>
 #include <melanolib/string/ascii.hpp>
 #include <melanolib/string/simple_stringutils.hpp>
+#include <melanolib/utils/singleton.hpp>
 /// \endcond
 
+#include "httpony/util/lru_cache.hpp"
 #include "httpony/util/version.hpp"
 
 namespace httpony {
@@ -54,7 +58,11 @@ public:
     UserAgent(const std::string& user_agent_string)
     {
         melanolib::string::QuickStream stream(user_agent_string);
-        std::string item;
+        Tokens tokens;
+        auto push = [&tokens](std::string item) {
+            if ( !item.empty() )
+                tokens.push_back(std::move(item));
+        };
         while ( !stream.eof() )
         {
             stream.ignore_if(melanolib::string::ascii::is_space_noline);
@@ -64,72 +72,64 @@ public:
             if ( melanolib::string::ascii::is_space(next) )
                 break;
             else if ( next == '(' )
-                append_raw(stream.get_until([](char c){ return c == ')'; }, false));
+                push(stream.get_until([](char c){ return c == ')'; }, false));
             else
-                append_raw(stream.get_until(melanolib::string::ascii::is_space));
+                push(stream.get_until(melanolib::string::ascii::is_space));
         }
+        if ( !tokens.empty() )
+            _tokens = std::make_shared<const Tokens>(std::move(tokens));
     }
 
     UserAgent(std::vector<std::string> items)
-        : tokens(std::move(items))
     {
-        tokens.erase(
-            std::remove_if(tokens.begin(), tokens.end(),
+        items.erase(
+            std::remove_if(items.begin(), items.end(),
                 [](const std::string& str) { return str.empty(); }),
-            tokens.end()
+            items.end()
         );
+        _tokens = std::make_shared<const Tokens>(std::move(items));
     }
 
     std::size_t size() const
     {
-        return tokens.size();
+        return tokens().size();
     }
 
     bool empty() const
     {
-        return tokens.empty();
-    }
-
-    auto begin()
-    {
-        return tokens.begin();
-    }
-
-    auto end()
-    {
-        return tokens.end();
+        return tokens().empty();
     }
 
     auto begin() const
     {
-        return tokens.begin();
+        return tokens().begin();
     }
 
     auto end() const
     {
-        return tokens.end();
+        return tokens().end();
     }
 
     auto cbegin() const
     {
-        return tokens.begin();
+        return tokens().begin();
     }
 
     auto cend() const
     {
-        return tokens.end();
+        return tokens().end();
     }
 
     const std::string& operator[](std::size_t pos) const
     {
-        return tokens[pos];
+        return tokens()[pos];
     }
 
     Type type_at(std::size_t pos) const
     {
-        if ( pos > size() || tokens[pos].empty() )
+        if ( pos > size() || tokens()[pos].empty() )
             return Type::Invalid;
-        if ( tokens[pos][0] == '(' )
+        if ( tokens()[pos][0] == '(' )
             return Type::Comment;
         return Type::Product;
     }
@@ -137,14 +137,14 @@ public:
     std::string comment(std::size_t pos) const
     {
         if ( type_at(pos) == UserAgent::Type::Comment )
-            return tokens[pos];
+            return tokens()[pos];
         return {};
     }
 
     std::string product(std::size_t pos) const
     {
         if ( type_at(pos) == UserAgent::Type::Product )
-            return tokens[pos];
+            return tokens()[pos];
         return {};
     }
 
@@ -153,11 +153,11 @@ public:
         if ( type_at(pos) != UserAgent::Type::Product )
             return {};
 
-        auto slash = tokens[pos].find('/');
+        auto slash = tokens()[pos].find('/');
         if ( slash == std::string::npos )
-            return tokens[pos];
+            return tokens()[pos];
         else
-            return tokens[pos].substr(0, slash);
+            return tokens()[pos].substr(0, slash);
     }
 
     std::string product_version(std::size_t pos) const
@@ -165,11 +165,11 @@ public:
         if ( type_at(pos) != UserAgent::Type::Product )
             return {};
 
-        auto slash = tokens[pos].find('/');
+        auto slash = tokens()[pos].find('/');
         if ( slash == std::string::npos )
             return {};
         else
-            return tokens[pos].substr(slash + 1);
+            return tokens()[pos].substr(slash + 1);
     }
 
     friend std::ostream& operator<<(std::ostream& os, const UserAgent& agent)
@@ -179,7 +179,7 @@ public:
 
     std::string string() const
     {
-        return melanolib::string::implode(" ", tokens);
+        return melanolib::string::implode(" ", tokens());
     }
 
     UserAgent& append_comment(const std::string& comment)
@@ -187,9 +187,9 @@ public:
         if ( comment.empty() )
             return *this;
         if ( comment.front() != '(' )
-            tokens.push_back('(' + comment + ')');
+            push_token('(' + comment + ')');
         else
-            tokens.push_back(comment);
+            push_token(comment);
 
         return *this;
     }
@@ -199,9 +199,9 @@ public:
         if ( name.empty() )
             return *this;
         if ( !version.empty() )
-            tokens.push_back(name + '/' + version);
+            push_token(name + '/' + version);
         else
-            tokens.push_back(name);
+            push_token(name);
 
         return *this;
     }
@@ -209,25 +209,97 @@ public:
     UserAgent& append_raw(const std::string& item)
     {
         if ( !item.empty() )
-            tokens.push_back(item);
+            push_token(item);
         return *this;
     }
 
     UserAgent operator+ (const UserAgent& oth) const
     {
         UserAgent result = *this;
-        result.tokens.insert(result.tokens.end(), oth.tokens.begin(), oth.tokens.end());
+        result += oth;
         return result;
     }
 
     UserAgent& operator+= (const UserAgent& oth)
     {
-        tokens.insert(tokens.end(), oth.tokens.begin(), oth.tokens.end());
+        if ( oth.empty() )
+            return *this;
+        Tokens output = tokens();
+        output.insert(output.end(), oth.tokens().begin(), oth.tokens().end());
+        _tokens = std::make_shared<const Tokens>(std::move(output));
         return *this;
     }
 
 private:
-    std::vector<std::string> tokens;
+    using Tokens = std::vector<std::string>;
+
+    const Tokens& tokens() const
+    {
+        static const Tokens empty;
+        return _tokens ? *_tokens : empty;
+    }
+
+    /**
+     * \brief Replaces the token list with a copy that has \p item appended
+     *
+     * The list is never modified in place, other copies keep seeing
+     * the old one.
+     */
+    void push_token(std::string item)
+    {
+        Tokens output = tokens();
+        output.push_back(std::move(item));
+        _tokens = std::make_shared<const Tokens>(std::move(output));
+    }
+
+    /// Immutable and shared between copies, so copying parsed user agents is cheap
+    std::shared_ptr<const Tokens> _tokens;
+};
+
+/**
+ * \brief Shared cache of parsed User-Agent strings
+ *
+ * Most traffic comes from a few distinct user agents, this avoids
+ * tokenizing the same string over and over.
+ */
+class UserAgentCache : public melanolib::Singleton<UserAgentCache>
+{
+public:
+    /**
+     * \brief Longest string that will be cached
+     */
+    static constexpr std::size_t max_length = 512;
+
+    /**
+     * \brief Returns the parsed user agent, from the cache if possible
+     */
+    UserAgent parse(const std::string& user_agent_string)
+    {
+        if ( user_agent_string.size() > max_length )
+            return UserAgent(user_agent_string);
+
+        return cache.get(user_agent_string, [](const std::string& string) {
+            return UserAgent(string);
+        });
+    }
+
+    void clear()
+    {
+        cache.clear();
+    }
+
+    std::size_t size() const
+    {
+        return cache.size();
+    }
+
+private:
+    UserAgentCache()
+        : cache(4096)
+    {}
+
+    friend ParentSingleton;
+    ShardedLruCache<std::string, UserAgent> cache;
 };
 
 } // namespace httpony
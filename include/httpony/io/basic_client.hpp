@@ -44,7 +44,10 @@ public:
         if ( endpoint_iterator ==  boost_tcp::resolver::iterator{} )
             return "Could not resolve " + target.authority.full();
 
-        return connection.socket().connect(endpoint_iterator);
+        status = connection.socket().connect(endpoint_iterator);
+        if ( !status.error() )
+            connection.cache_endpoints();
+        return status;
     }
 
     /**
@@ -80,12 +83,15 @@ public:
         boost_tcp::resolver::query query = make_query(target, connection);
         connection.socket().async_connect(
             query,
-            [on_error, on_connect](
+            [on_error, on_connect, connection](
                 const OperationStatus& status,
-                const boost_tcp::resolver::iterator&)
+                const boost_tcp::resolver::iterator&) mutable
             {
                 if ( status )
+                {
+                    connection.cache_endpoints();
                     on_connect();
+                }
                 else
                     on_error(status);
             }
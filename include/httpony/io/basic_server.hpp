@@ -165,7 +165,10 @@ private:
                         connection.socket().set_timeout(*_timeout);
 
                     if ( !error )
+                    {
+                        conn_iter->cache_endpoints();
                         on_success(*conn_iter);
+                    }
                     else
                         on_failure(*conn_iter, error_to_status(error));
 
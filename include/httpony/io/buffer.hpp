@@ -23,8 +23,10 @@
 
 /// \cond
 #include <limits>
+#include <memory>
 /// \endcond
 
+#include "httpony/io/memory_budget.hpp"
 #include "httpony/io/socket.hpp"
 
 namespace httpony {
@@ -37,8 +39,12 @@ namespace io {
 class NetworkInputBuffer : public boost::asio::streambuf
 {
 public:
-    explicit NetworkInputBuffer(TimeoutSocket& socket)
-        : _socket(socket)
+    /**
+     * \param account If not null, the buffered bytes are recorded as
+     *                Input usage and reads which would exceed its budget fail
+     */
+    explicit NetworkInputBuffer(TimeoutSocket& socket, MemoryAccount* account = nullptr)
+        : _socket(socket), _account(account)
     {
     }
 
@@ -116,6 +122,7 @@ protected:
 private:
 
     TimeoutSocket& _socket;
+    MemoryAccount* _account;
     std::size_t _expected_input = 0;
     OperationStatus _status;
     std::size_t _total_read_size = 0;
@@ -123,6 +130,23 @@ private:
 
 using NetworkOutputBuffer = boost::asio::streambuf;
 
+/**
+ * \brief Input and output buffers of a connection
+ *
+ * Connections only create them once they read or write, so connections
+ * waiting to be accepted don't hold any buffer memory.
+ */
+class NetworkBuffers
+{
+public:
+    NetworkBuffers(TimeoutSocket& socket, MemoryAccount* account)
+        : input(socket, account)
+    {}
+
+    NetworkInputBuffer  input;
+    NetworkOutputBuffer output;
+};
+
 } // namespace io
 } // namespace httpony
 #endif // HTTPONY_IO_BUFFER_HPP
@@ -46,37 +46,158 @@ public:
 
     NetworkInputBuffer& input_buffer()
     {
-        return data->input_buffer;
+        return data->get_buffers().input;
     }
 
     NetworkOutputBuffer& output_buffer()
     {
-        return data->output_buffer;
+        return data->get_buffers().output;
     }
 
     OperationStatus commit_output()
     {
-        if ( data->output_buffer.size() == 0 )
+        if ( !data->buffers || data->buffers->output.size() == 0 )
             return {};
+        NetworkBuffers& buffers = *data->buffers;
+        data->memory.set(MemoryAccount::Output, buffers.output.size());
         OperationStatus status;
-        data->socket.write(data->output_buffer.data(), status);
-        data->output_buffer.consume(data->output_buffer.size());
+        data->socket.write(buffers.output.data(), status);
+        buffers.output.consume(buffers.output.size());
+        data->memory.set(MemoryAccount::Output, 0);
         return status;
     }
 
+    /**
+     * \brief Sends a sequence of buffers after any pending output
+     *
+     * Small buffers are collected in the output buffer, larger ones are
+     * written to the socket directly without being copied.
+     */
+    template<class ConstBufferSequence>
+        OperationStatus write(const ConstBufferSequence& buffers)
+    {
+        for ( const auto& buffer : buffers )
+        {
+            std::size_t size = boost::asio::buffer_size(buffer);
+            if ( size < direct_write_size() )
+            {
+                NetworkOutputBuffer& output = output_buffer();
+                boost::asio::buffer_copy(output.prepare(size), buffer);
+                output.commit(size);
+                continue;
+            }
+
+            OperationStatus status = commit_output();
+            if ( status.error() )
+                return status;
+            data->socket.write(buffer, status);
+            if ( status.error() )
+                return status;
+        }
+        return commit_output();
+    }
+
+    /**
+     * \brief Minimum size for write() to send a buffer without copying it
+     */
+    static constexpr std::size_t direct_write_size()
+    {
+        return 4096;
+    }
+
     void close()
     {
         data->socket.close();
     }
 
-    IPAddress remote_address() const
+    /**
+     * \brief Reads the remote and local endpoints from the socket
+     *
+     * Called after the connection has been accepted or established,
+     * further queries on the addresses don't involve the socket.
+     * It must not be called while other threads use the connection.
+     */
+    void cache_endpoints()
     {
-        return data->socket.remote_address();
+        data->remote.set(data->socket.remote_binary_address());
+        data->local.set(data->socket.local_binary_address());
     }
 
-    IPAddress local_address() const
+    /**
+     * \brief Remote address read by cache_endpoints()
+     *
+     * Invalid if cache_endpoints() hasn't been called,
+     * use query_remote_address() in that case.
+     */
+    const IPAddress& remote_address() const
     {
-        return data->socket.local_address();
+        return data->remote.address();
+    }
+
+    /**
+     * \brief Local address read by cache_endpoints()
+     *
+     * Invalid if cache_endpoints() hasn't been called,
+     * use query_local_address() in that case.
+     */
+    const IPAddress& local_address() const
+    {
+        return data->local.address();
+    }
+
+    const BinaryIPAddress& remote_binary_address() const
+    {
+        return data->remote.binary();
+    }
+
+    const BinaryIPAddress& local_binary_address() const
+    {
+        return data->local.binary();
+    }
+
+    /**
+     * \brief Textual form of the remote address (without port)
+     */
+    const std::string& remote_address_string() const
+    {
+        return data->remote.address().string;
+    }
+
+    /**
+     * \brief Textual form of the local address (without port)
+     */
+    const std::string& local_address_string() const
+    {
+        return data->local.address().string;
+    }
+
+    /**
+     * \brief Reads the remote address from the socket, without caching it
+     */
+    BinaryIPAddress query_remote_address() const
+    {
+        return data->socket.remote_binary_address();
+    }
+
+    /**
+     * \brief Reads the local address from the socket, without caching it
+     */
+    BinaryIPAddress query_local_address() const
+    {
+        return data->socket.local_binary_address();
+    }
+
+    /**
+     * \brief Memory held by the connection buffers
+     */
+    MemoryAccount& memory_account()
+    {
+        return data->memory;
+    }
+
+    const MemoryAccount& memory_account() const
+    {
+        return data->memory;
     }
 
     bool connected() const
@@ -114,6 +235,38 @@ public:
     }
 
 private:
+    /**
+     * \brief Address with its textual form, both computed when it's set
+     */
+    class CachedAddress
+    {
+    public:
+        void set(const BinaryIPAddress& address)
+        {
+            _binary = address;
+            _address = _binary.to_ip_address();
+        }
+
+        const BinaryIPAddress& binary() const
+        {
+            return _binary;
+        }
+
+        const IPAddress& address() const
+        {
+            return _address;
+        }
+
+    private:
+        BinaryIPAddress _binary;
+        IPAddress _address;
+    };
+
+    /**
+     * \brief Shared state of the Connection objects pointing to it
+     *
+     * Buffers are only created once they are needed.
+     */
     struct Data
     {
         template<class... SocketArgs>
@@ -121,9 +274,18 @@ private:
                 : socket(std::forward<SocketArgs>(args)...)
         {}
 
+        NetworkBuffers& get_buffers()
+        {
+            if ( !buffers )
+                buffers = std::make_unique<NetworkBuffers>(socket, &memory);
+            return *buffers;
+        }
+
         TimeoutSocket       socket;
-        NetworkInputBuffer  input_buffer{socket};
-        NetworkOutputBuffer output_buffer;
+        MemoryAccount       memory;
+        std::unique_ptr<NetworkBuffers> buffers;
+        CachedAddress       remote;
+        CachedAddress       local;
     };
 
     std::shared_ptr<Data> data;
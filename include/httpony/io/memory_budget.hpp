@@ -0,0 +1,294 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTPONY_IO_MEMORY_BUDGET_HPP
+#define HTTPONY_IO_MEMORY_BUDGET_HPP
+
+/// \cond
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <unordered_set>
+/// \endcond
+
+namespace httpony {
+namespace io {
+
+class MemoryBudget;
+
+/**
+ * \brief Bytes held by a single connection
+ *
+ * The sizes are updated by the thread using the connection, the total
+ * can be read from any thread.
+ */
+class MemoryAccount
+{
+public:
+    /**
+     * \brief What the memory is used for
+     */
+    enum Usage
+    {
+        Input,      ///< Data read from the socket but not yet consumed
+        Output,     ///< Data waiting to be sent
+        Body,       ///< Request body being received
+        Response,   ///< Response body waiting to be sent
+        UsageCount
+    };
+
+    MemoryAccount() = default;
+    MemoryAccount(const MemoryAccount&) = delete;
+    MemoryAccount& operator=(const MemoryAccount&) = delete;
+
+    ~MemoryAccount()
+    {
+        attach(nullptr);
+    }
+
+    /**
+     * \brief Moves the account (and the bytes it holds) to a different budget
+     * \note \p budget must outlive the account or until it's detached
+     */
+    void attach(MemoryBudget* budget);
+
+    MemoryBudget* budget() const
+    {
+        return _budget;
+    }
+
+    /**
+     * \brief Sets the number of bytes held for \p usage
+     * \returns \b false if growing beyond the budget was denied,
+     *          in which case the size is not changed
+     */
+    bool update(Usage usage, std::size_t size);
+
+    /**
+     * \brief Sets the number of bytes held for \p usage even if
+     * it goes beyond the budget
+     *
+     * Used to record memory which has already been allocated
+     */
+    void set(Usage usage, std::size_t size);
+
+    std::size_t used(Usage usage) const
+    {
+        return _usage[usage];
+    }
+
+    /**
+     * \brief Total number of bytes held
+     */
+    std::size_t used() const
+    {
+        return _total.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Whether update() may block waiting for other accounts to
+     * release memory, with the Backpressure policy
+     *
+     * Off by default, a thread which also accepts connections must not wait.
+     */
+    bool can_wait() const
+    {
+        return _can_wait;
+    }
+
+    void set_can_wait(bool can_wait)
+    {
+        _can_wait = can_wait;
+    }
+
+    /**
+     * \brief Whether the budget has asked for the connection to be dropped
+     */
+    bool shed() const
+    {
+        return _shed.load(std::memory_order_relaxed);
+    }
+
+private:
+    void change(Usage usage, std::size_t size);
+
+    MemoryBudget* _budget = nullptr;
+    std::size_t _usage[UsageCount] = {};
+    std::atomic<std::size_t> _total{0};
+    std::atomic<bool> _shed{false};
+    bool _can_wait = false;
+
+    friend MemoryBudget;
+};
+
+/**
+ * \brief Limits the memory held by a group of connections
+ *
+ * When a connection needs to grow beyond the limit, the budget either
+ * makes it wait for other connections to release memory (Backpressure)
+ * or marks the connections holding the most memory to be dropped (Shed).
+ * Memory held by marked connections is only available once they have
+ * released it, the limit is never exceeded to make room in advance.
+ *
+ * Either way connections only wait for accounts which allow it (see
+ * MemoryAccount::can_wait()) and while other connections hold enough
+ * memory to make room, the largest connection is denied right away.
+ */
+class MemoryBudget
+{
+public:
+    enum class Policy
+    {
+        Backpressure,   ///< Wait for other connections to release memory, up to backpressure_timeout()
+        Shed,           ///< Drop the largest consumers to make room, then wait like Backpressure
+    };
+
+    struct Stats
+    {
+        std::size_t used = 0;           ///< Bytes currently held
+        std::size_t peak = 0;           ///< Maximum value reached by used
+        std::size_t limit = 0;          ///< Configured limit
+        std::size_t connections = 0;    ///< Number of attached accounts
+        std::size_t largest = 0;        ///< Bytes held by the largest account
+        std::size_t denied = 0;         ///< Number of requests for memory denied
+        std::size_t shed = 0;           ///< Number of accounts marked for dropping
+    };
+
+    explicit MemoryBudget(std::size_t limit = unlimited(), Policy policy = Policy::Backpressure)
+        : _limit(limit), _policy(policy)
+    {}
+
+    MemoryBudget(const MemoryBudget&) = delete;
+    MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+    ~MemoryBudget();
+
+    static constexpr std::size_t unlimited()
+    {
+        return std::numeric_limits<std::size_t>::max();
+    }
+
+    std::size_t limit() const
+    {
+        return _limit;
+    }
+
+    void set_limit(std::size_t limit);
+
+    Policy policy() const
+    {
+        return _policy;
+    }
+
+    void set_policy(Policy policy)
+    {
+        _policy = policy;
+    }
+
+    /**
+     * \brief Maximum time a connection waits for memory with the
+     * Backpressure policy
+     */
+    std::chrono::milliseconds backpressure_timeout() const
+    {
+        return _backpressure_timeout;
+    }
+
+    void set_backpressure_timeout(std::chrono::milliseconds timeout)
+    {
+        _backpressure_timeout = timeout;
+    }
+
+    /**
+     * \brief Bytes currently held by the attached accounts
+     */
+    std::size_t used() const
+    {
+        return _used.load(std::memory_order_relaxed);
+    }
+
+    Stats stats() const;
+
+private:
+    /**
+     * \brief Adds \p bytes to the memory used by \p account if the policy allows it
+     */
+    bool acquire(MemoryAccount& account, std::size_t bytes);
+
+    /**
+     * \brief Adds \p bytes regardless of the limit
+     */
+    void force_acquire(std::size_t bytes);
+
+    void release(std::size_t bytes);
+
+    /**
+     * \brief Atomically adds \p bytes if they fit in the limit
+     */
+    bool try_acquire(std::size_t bytes);
+
+    void update_peak(std::size_t used);
+
+    /**
+     * \brief Number of bytes to be released for \p bytes more to fit
+     * in the limit, or unlimited() if they can never fit
+     */
+    std::size_t shortfall(std::size_t bytes) const;
+
+    /**
+     * \brief Marks the largest accounts to be dropped until they hold
+     * enough memory for \p bytes more to fit, counting the ones already marked
+     * \returns \b false if there aren't enough accounts larger than \p account
+     * \pre \c mutex is locked
+     */
+    bool shed_others(const MemoryAccount& account, std::size_t bytes);
+
+    /**
+     * \brief Whether other accounts hold enough memory for \p bytes to fit
+     * once they release it, and \p account isn't the largest one
+     * \pre \c mutex is locked
+     */
+    bool others_can_release(const MemoryAccount& account, std::size_t bytes) const;
+
+    void add_account(MemoryAccount* account);
+    void remove_account(MemoryAccount* account);
+
+    std::atomic<std::size_t> _used{0};
+    std::atomic<std::size_t> _peak{0};
+    std::atomic<std::size_t> _limit;
+    std::atomic<Policy> _policy;
+    std::atomic<std::chrono::milliseconds> _backpressure_timeout{std::chrono::seconds(5)};
+    std::atomic<std::size_t> _denied{0};
+    std::atomic<std::size_t> _shed{0};
+    std::atomic<std::size_t> _waiting{0};
+
+    mutable std::mutex mutex;
+    std::condition_variable released;
+    std::unordered_set<MemoryAccount*> accounts;
+
+    friend MemoryAccount;
+};
+
+} // namespace io
+} // namespace httpony
+#endif // HTTPONY_IO_MEMORY_BUDGET_HPP
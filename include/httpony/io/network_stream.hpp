@@ -24,6 +24,7 @@
 
 /// \cond
 #include <iostream>
+#include <vector>
 /// \endcond
 
 #include "httpony/mime_type.hpp"
@@ -225,9 +226,28 @@ public:
     {
         flush();
         buffer.consume(buffer.size());
+        references.clear();
+        referenced_size = 0;
         rdbuf(nullptr);
     }
 
+    /**
+     * \brief Appends \p size bytes from \p data to the payload without copying them
+     *
+     * \p data must stay valid and unchanged until the payload has been sent
+     */
+    void write_reference(const char* data, std::size_t size)
+    {
+        flush();
+        references.push_back(Reference{buffer.size(), data, size});
+        referenced_size += size;
+    }
+
+    void write_reference(const std::string& data)
+    {
+        write_reference(data.data(), data.size());
+    }
+
     /**
      * \brief Whether there is some data to send (which might have 0 length) or no data at all
      */
@@ -238,7 +258,7 @@ public:
 
     std::size_t content_length() const
     {
-        return buffer.size();
+        return buffer.size() + referenced_size;
     }
 
     MimeType content_type() const
@@ -246,28 +266,67 @@ public:
         return _content_type;
     }
 
+    /**
+     * \brief Returns the payload as a list of buffers for a gather write
+     *
+     * The buffers refer to the data in the stream and to the data passed
+     * to write_reference(), they are invalidated by further output.
+     */
+    std::vector<boost::asio::const_buffer> gather() const
+    {
+        std::vector<boost::asio::const_buffer> result;
+        if ( !has_data() )
+            return result;
+
+        result.reserve(references.size() * 2 + 1);
+        const char* stored = boost::asio::buffer_cast<const char*>(buffer.data());
+        std::size_t position = 0;
+        for ( const auto& reference : references )
+        {
+            if ( reference.offset > position )
+                result.emplace_back(stored + position, reference.offset - position);
+            if ( reference.size )
+                result.emplace_back(reference.data, reference.size);
+            position = reference.offset;
+        }
+        if ( buffer.size() > position )
+            result.emplace_back(stored + position, buffer.size() - position);
+
+        return result;
+    }
+
     /**
      * \brief Writes the payload to a stream
      */
     void write_to(std::ostream& output)
     {
-        if ( has_data() )
+        flush();
+        for ( const auto& buf : gather() )
         {
-            for ( const auto& buf : buffer.data() )
-            {
-                auto data = boost::asio::buffer_cast<const char*>(buf);
-                auto size = boost::asio::buffer_size(buf);
-                if ( !output.write(data, size) )
-                    return;
-            }
+            auto data = boost::asio::buffer_cast<const char*>(buf);
+            auto size = boost::asio::buffer_size(buf);
+            if ( !output.write(data, size) )
+                return;
         }
     }
 
 private:
+    /**
+     * \brief Data passed to write_reference()
+     */
+    struct Reference
+    {
+        std::size_t offset; ///< Position in \p buffer the data is inserted at
+        const char* data;
+        std::size_t size;
+    };
+
     void copy_from(OutputContentStream& other);
 
     boost::asio::streambuf buffer;
     MimeType _content_type;
+    std::vector<Reference> references;
+    std::size_t referenced_size = 0;
 };
 
 /**
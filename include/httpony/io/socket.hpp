@@ -108,21 +108,31 @@ public:
     }
 
     virtual IPAddress remote_address() const
+    {
+        return remote_binary_address().to_ip_address();
+    }
+
+    virtual IPAddress local_address() const
+    {
+        return local_binary_address().to_ip_address();
+    }
+
+    virtual BinaryIPAddress remote_binary_address() const
     {
         boost::system::error_code error;
         auto endpoint = raw_socket().remote_endpoint(error);
         if ( error )
             return {};
-        return endpoint_to_ip(endpoint);
+        return endpoint_to_binary(endpoint);
     }
 
-    virtual IPAddress local_address() const
+    virtual BinaryIPAddress local_binary_address() const
     {
         boost::system::error_code error;
         auto endpoint = raw_socket().local_endpoint(error);
         if ( error )
             return {};
-        return endpoint_to_ip(endpoint);
+        return endpoint_to_binary(endpoint);
     }
 
     /**
@@ -130,11 +140,18 @@ public:
      */
     static IPAddress endpoint_to_ip(const boost_tcp::endpoint& endpoint)
     {
-        return IPAddress(
-            endpoint.address().is_v6() ? IPAddress::Type::IPv6 : IPAddress::Type::IPv4,
-            endpoint.address().to_string(),
-            endpoint.port()
-        );
+        return endpoint_to_binary(endpoint).to_ip_address();
+    }
+
+    /**
+     * \brief Converts a boost endpoint to a BinaryIPAddress without formatting it
+     */
+    static BinaryIPAddress endpoint_to_binary(const boost_tcp::endpoint& endpoint)
+    {
+        auto address = endpoint.address();
+        if ( address.is_v4() )
+            return BinaryIPAddress(IPAddress::Type::IPv4, address.to_v4().to_bytes().data(), endpoint.port());
+        return BinaryIPAddress(IPAddress::Type::IPv6, address.to_v6().to_bytes().data(), endpoint.port());
     }
 };
 
@@ -314,6 +331,16 @@ public:
         return _socket->local_address();
     }
 
+    BinaryIPAddress remote_binary_address() const
+    {
+        return _socket->remote_binary_address();
+    }
+
+    BinaryIPAddress local_binary_address() const
+    {
+        return _socket->local_binary_address();
+    }
+
     /**
      * \brief Queues an async connection
      * \tparam Callback A functor accepting an OperationStatus
@@ -0,0 +1,129 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTPONY_IP_ACCESS_LIST_HPP
+#define HTTPONY_IP_ACCESS_LIST_HPP
+
+/// \cond
+#include <shared_mutex>
+#include <vector>
+/// \endcond
+
+#include "httpony/ip_address.hpp"
+
+namespace httpony {
+
+/**
+ * \brief Allow/deny list of address ranges
+ *
+ * Ranges are stored in a binary trie indexed by the address bits, the rule
+ * of the longest matching prefix applies. Looking up an address only walks
+ * the bits of its bytes, no string is created.
+ *
+ * IPv4 ranges match both IPv4 addresses and IPv4-mapped IPv6 addresses.
+ */
+class IPAccessList
+{
+public:
+    enum class Rule
+    {
+        Allow,
+        Deny,
+    };
+
+    /**
+     * \param default_rule Rule for addresses not matching any range
+     */
+    explicit IPAccessList(Rule default_rule = Rule::Allow);
+
+    IPAccessList(const IPAccessList&) = delete;
+    IPAccessList& operator=(const IPAccessList&) = delete;
+
+    /**
+     * \brief Adds a range in CIDR notation (eg: 10.0.0.0/8 or 2001:db8::/32)
+     *
+     * A plain address adds a range only containing that address.
+     * \returns \b false if \p range is not valid
+     */
+    bool add(const std::string& range, Rule rule);
+
+    /**
+     * \brief Adds the range of addresses sharing the first \p prefix_length
+     * bits with \p address
+     *
+     * For IPv4 addresses \p prefix_length is in [0, 32], otherwise in [0, 128]
+     * \returns \b false if the address or the prefix length are not valid
+     */
+    bool add(const BinaryIPAddress& address, unsigned prefix_length, Rule rule);
+
+    bool allow(const std::string& range)
+    {
+        return add(range, Rule::Allow);
+    }
+
+    bool deny(const std::string& range)
+    {
+        return add(range, Rule::Deny);
+    }
+
+    /**
+     * \brief Rule of the longest range containing \p address
+     *
+     * Invalid addresses get the default rule
+     */
+    Rule check(const BinaryIPAddress& address) const;
+
+    bool allowed(const BinaryIPAddress& address) const
+    {
+        return check(address) == Rule::Allow;
+    }
+
+    Rule default_rule() const;
+
+    void set_default_rule(Rule rule);
+
+    /**
+     * \brief Removes all the ranges
+     */
+    void clear();
+
+    /**
+     * \brief Whether there are no ranges
+     */
+    bool empty() const;
+
+private:
+    struct Node
+    {
+        /// Indices of the children, 0 when missing (the root is never a child)
+        uint32_t children[2] = {0, 0};
+        /// Rule for the prefix ending at this node, if any
+        bool has_rule = false;
+        Rule rule = Rule::Allow;
+    };
+
+    std::vector<Node> nodes;
+    Rule _default_rule;
+    mutable std::shared_timed_mutex mutex;
+};
+
+} // namespace httpony
+#endif // HTTPONY_IP_ACCESS_LIST_HPP
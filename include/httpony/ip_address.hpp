@@ -23,12 +23,11 @@
 #define HTTPONY_IP_ADDRESS_HPP
 
 /// \cond
+#include <array>
 #include <string>
 #include <cstdint>
 #include <ostream>
 #include <algorithm>
-
-#include <melanolib/string/simple_stringutils.hpp>
 /// \endcond
 
 namespace httpony {
@@ -58,36 +57,13 @@ struct IPAddress
         : type(type), port(port)
     {}
 
-    explicit IPAddress(const std::string& address, Type default_type = Type::IPv6)
-    {
-        static std::regex ip_regex(
-            "(?:"
-                "((?:[0-9]{1,3}\\.){3}[0-9]{1,3})|"
-                "\\[?((?:[0-9a-fA-F]|::)[0-9a-fA-F:]*)\\]?|"
-                "([^:]*)"
-            ")(?::([0-9]+))?",
-            std::regex::ECMAScript|std::regex::optimize
-        );
-        std::smatch match;
-        if ( std::regex_match(address, match, ip_regex) )
-        {
-            type = default_type;
-
-            if ( match.length(1) )
-            {
-                string = match[1];
-                type = IPAddress::Type::IPv4;
-            }
-            else if ( match.length(2) )
-            {
-                string = match[2];
-                type = IPAddress::Type::IPv6;
-            }
-
-            if ( match.length(4) )
-                port = melanolib::string::to_uint(match[4]);
-        }
-    }
+    /**
+     * \brief Parses an address in the form \c host, \c host:port or \c [host]:port
+     *
+     * If the host is not a numeric address, string is left empty
+     * and type is set to \p default_type.
+     */
+    explicit IPAddress(const std::string& address, Type default_type = Type::IPv6);
 
     Type type = Type::Invalid;
     std::string string;
@@ -107,5 +83,108 @@ inline std::ostream& operator<<(std::ostream& os, const IPAddress& ip)
     return os << ':' << ip.port;
 }
 
+/**
+ * \brief IP address and port in network byte order
+ *
+ * IPv4 addresses are stored as IPv4-mapped IPv6 addresses (::ffff:a.b.c.d)
+ * so both families can be compared and matched by prefix in the same way.
+ * The textual form is only generated when requested.
+ */
+struct BinaryIPAddress
+{
+    using Bytes = std::array<uint8_t, 16>;
+
+    BinaryIPAddress() = default;
+
+    /**
+     * \brief Copies the address from raw bytes in network order
+     * \param data 4 bytes for IPv4, 16 bytes for IPv6
+     */
+    BinaryIPAddress(IPAddress::Type type, const uint8_t* data, uint16_t port = 0)
+        : type(type), port(port)
+    {
+        if ( type == IPAddress::Type::IPv4 )
+        {
+            bytes[10] = bytes[11] = 0xff;
+            std::copy(data, data + 4, bytes.begin() + 12);
+        }
+        else if ( type == IPAddress::Type::IPv6 )
+        {
+            std::copy(data, data + 16, bytes.begin());
+        }
+    }
+
+    /**
+     * \brief Parses a numeric address (without port)
+     *
+     * If \p address is not a valid IPv4 or IPv6 address, the result is invalid
+     */
+    explicit BinaryIPAddress(const std::string& address, uint16_t port = 0)
+        : BinaryIPAddress(address.data(), address.data() + address.size(), port)
+    {}
+
+    BinaryIPAddress(const char* begin, const char* end, uint16_t port = 0);
+
+    /**
+     * \brief Parses the string of \p address
+     */
+    explicit BinaryIPAddress(const IPAddress& address)
+        : BinaryIPAddress(address.string, address.port)
+    {}
+
+    bool valid() const
+    {
+        return type != IPAddress::Type::Invalid;
+    }
+
+    /**
+     * \brief Whether the address is IPv4 or IPv4-mapped IPv6
+     */
+    bool is_ipv4_mapped() const
+    {
+        return valid() && bytes[10] == 0xff && bytes[11] == 0xff &&
+            std::all_of(bytes.begin(), bytes.begin() + 10, [](uint8_t b){ return b == 0; });
+    }
+
+    /**
+     * \brief Value of the bit at \p index, counting from the most significant
+     */
+    bool bit(std::size_t index) const
+    {
+        return (bytes[index / 8] >> (7 - index % 8)) & 1;
+    }
+
+    /**
+     * \brief Textual representation of the address (without port)
+     */
+    std::string address_string() const;
+
+    IPAddress to_ip_address() const
+    {
+        if ( !valid() )
+            return {};
+        return IPAddress(type, address_string(), port);
+    }
+
+    bool operator==(const BinaryIPAddress& other) const
+    {
+        return type == other.type && port == other.port && bytes == other.bytes;
+    }
+
+    bool operator!=(const BinaryIPAddress& other) const
+    {
+        return !(*this == other);
+    }
+
+    Bytes bytes{};
+    IPAddress::Type type = IPAddress::Type::Invalid;
+    uint16_t port = 0;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const BinaryIPAddress& ip)
+{
+    return os << ip.to_ip_address();
+}
+
 } // namespace httpony
 #endif // HTTPONY_IP_ADDRESS_HPP
@@ -0,0 +1,160 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef HTTPONY_MIME_RESOLVER_HPP
+#define HTTPONY_MIME_RESOLVER_HPP
+
+/// \cond
+#include <functional>
+#include <istream>
+#include <mutex>
+#include <unordered_map>
+/// \endcond
+
+#include "httpony/mime_type.hpp"
+#include "httpony/util/lru_cache.hpp"
+
+namespace httpony {
+
+/**
+ * \brief Determines the MimeType of files to be served
+ *
+ * Files are looked up by extension first, content sniffing is only used
+ * for extensions which aren't known and its results are cached until the
+ * file changes size or modification time.
+ *
+ * Extensions should be set up before the resolver is used, after that
+ * resolve() can be called from multiple threads.
+ */
+class MimeResolver
+{
+public:
+    /**
+     * \brief Function determining the type of a file from its contents
+     *
+     * It should return an invalid MimeType if it can't determine the type.
+     * It can be called from multiple threads at the same time.
+     */
+    using Sniffer = std::function<MimeType (const std::string& filename)>;
+
+    /**
+     * \brief Creates a resolver with a built-in list of common extensions
+     */
+    explicit MimeResolver(
+        Sniffer sniffer = {},
+        MimeType fallback = MimeType("application", "octet-stream")
+    );
+
+    /**
+     * \brief Loads extensions from a file in the format of /etc/mime.types
+     * \returns \b false if the file couldn't be read
+     */
+    bool load_mime_types(const std::string& filename = "/etc/mime.types");
+
+    /**
+     * \brief Loads extensions from a stream in the format of /etc/mime.types
+     *
+     * Each line contains a mime type followed by its extensions,
+     * \c # starts a comment.
+     */
+    void load_mime_types(std::istream& input);
+
+    /**
+     * \brief Associates an extension (without the dot) to a type
+     */
+    void add_extension(const std::string& extension, const MimeType& type);
+
+    void set_sniffer(Sniffer sniffer)
+    {
+        _sniffer = std::move(sniffer);
+    }
+
+    /**
+     * \brief Type to use when everything else fails
+     */
+    void set_fallback(const MimeType& fallback)
+    {
+        _fallback = fallback;
+    }
+
+    /**
+     * \brief Maximum number of sniffed files to remember,
+     * the least recently used ones are forgotten first
+     */
+    void set_cache_size(std::size_t size);
+
+    /**
+     * \brief Type associated with the extension of \p filename
+     * \returns An invalid MimeType if the extension isn't known
+     */
+    MimeType from_extension(const std::string& filename) const;
+
+    /**
+     * \brief Determines the type of the given file
+     */
+    MimeType resolve(const std::string& filename);
+
+    void clear_cache();
+
+private:
+    /**
+     * \brief Identifies a file on the system
+     */
+    struct FileId
+    {
+        unsigned long long device;
+        unsigned long long inode;
+
+        bool operator==(const FileId& other) const
+        {
+            return device == other.device && inode == other.inode;
+        }
+
+        struct Hash
+        {
+            std::size_t operator()(const FileId& id) const
+            {
+                return std::hash<unsigned long long>()(id.inode ^ (id.device << 32));
+            }
+        };
+    };
+
+    /**
+     * \brief Sniffed type and the state of the file it was sniffed from
+     */
+    struct CacheEntry
+    {
+        long long size;
+        long long modified_seconds;
+        long modified_nanoseconds;
+        MimeType type;
+    };
+
+    std::unordered_map<std::string, MimeType> _extensions;
+    Sniffer _sniffer;
+    MimeType _fallback;
+    LruCache<FileId, CacheEntry, FileId::Hash> _cache{1024};
+    std::mutex _cache_mutex;
+};
+
+} // namespace httpony
+#endif // HTTPONY_MIME_RESOLVER_HPP
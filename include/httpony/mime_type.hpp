@@ -23,6 +23,7 @@
 #define HTTPONY_MIME_TYPE_HPP
 
 /// \cond
+#include <memory>
 #include <ostream>
 
 #include <melanolib/string/simple_stringutils.hpp>
@@ -30,6 +31,41 @@
 
 namespace httpony {
 
+namespace detail {
+
+    /**
+     * \brief Type and subtype of a MimeType
+     */
+    struct MediaType
+    {
+        std::string type;
+        std::string subtype;
+        std::string name;       ///< type/subtype
+        bool interned = false;  ///< Whether it's in the table of common types
+    };
+
+    /**
+     * \brief Finds \p type / \p subtype among the common types, ignoring case
+     * \returns \b nullptr if not found
+     */
+    const MediaType* find_media_type(
+        const char* type, std::size_t type_size,
+        const char* subtype, std::size_t subtype_size
+    );
+
+    /**
+     * \brief Returns the interned media type or a new one if it isn't common
+     */
+    std::shared_ptr<const MediaType> media_type(const std::string& type, const std::string& subtype);
+
+} // namespace detail
+
+/**
+ * \brief Media type with an optional parameter
+ *
+ * Common types are shared from a global table, so comparing them only
+ * compares pointers and formatting them uses the pre-rendered name.
+ */
 class MimeType
 {
 public:
@@ -38,23 +74,24 @@ public:
     MimeType(const std::string& string);
     MimeType(const char* string) : MimeType(std::string(string)) {}
 
-    MimeType(){}
+    MimeType()
+        : _media(detail::media_type({}, {}))
+    {}
 
     MimeType(const std::string& type, const std::string& subtype, const Parameter& param = {})
+        : _media(detail::media_type(type, subtype))
     {
-        set_type(type);
-        set_subtype(subtype);
         set_parameter(param);
     }
 
     bool valid() const
     {
-        return !_type.empty() && !_subtype.empty();
+        return !_media->type.empty() && !_media->subtype.empty();
     }
 
     bool operator==(const MimeType& oth) const
     {
-        return _type == oth._type && _subtype == oth._subtype &&
+        return matches_type(oth) &&
             _parameter.first == oth._parameter.first && _parameter.second == oth._parameter.second;
     }
 
@@ -65,12 +102,12 @@ public:
 
     void set_type(const std::string& type)
     {
-        _type = melanolib::string::strtolower(type);
+        _media = detail::media_type(type, _media->subtype);
     }
 
     void set_subtype(const std::string& subtype)
     {
-        _subtype = melanolib::string::strtolower(subtype);
+        _media = detail::media_type(_media->type, subtype);
     }
 
     void set_parameter(const Parameter& param)
@@ -89,14 +126,22 @@ public:
             _parameter.second = param.second;
     }
 
-    std::string type() const
+    const std::string& type() const
+    {
+        return _media->type;
+    }
+
+    const std::string& subtype() const
     {
-        return _type;
+        return _media->subtype;
     }
 
-    std::string subtype() const
+    /**
+     * \brief Type and subtype, without the parameter
+     */
+    const std::string& name() const
     {
-        return _subtype;
+        return _media->name;
     }
 
     Parameter parameter() const
@@ -106,34 +151,36 @@ public:
 
     bool matches_type(const std::string& type, const std::string& subtype) const
     {
-        return _type == type && _subtype == subtype;
+        return _media->type == type && _media->subtype == subtype;
     }
 
     bool matches_type(const MimeType& other) const
     {
-        return matches_type(other._type, other._subtype);
+        if ( _media == other._media )
+            return true;
+        // Interned types are unique so different pointers mean different types
+        if ( _media->interned && other._media->interned )
+            return false;
+        return _media->type == other._media->type && _media->subtype == other._media->subtype;
     }
 
     std::string string() const
     {
-        std::string result;
-        result += _type + '/' + _subtype;
-        if ( !_parameter.first.empty() )
-            result += ';' + _parameter.first + '=' + _parameter.second;
-        return result;
+        if ( _parameter.first.empty() )
+            return _media->name;
+        return _media->name + ';' + _parameter.first + '=' + _parameter.second;
     }
 
     friend std::ostream& operator<<(std::ostream& os, const MimeType& mime)
     {
-        os << mime._type << '/' << mime._subtype;
+        os << mime._media->name;
         if ( !mime._parameter.first.empty() )
             os << ';' << mime._parameter.first << '=' << mime._parameter.second;
         return os;
     }
 
 private:
-    std::string _type;
-    std::string _subtype;
+    std::shared_ptr<const detail::MediaType> _media;
     Parameter _parameter;
 };
 
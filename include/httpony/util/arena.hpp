@@ -0,0 +1,199 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTPONY_ARENA_HPP
+#define HTTPONY_ARENA_HPP
+
+/// \cond
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+/// \endcond
+
+namespace httpony {
+
+/**
+ * \brief Monotonic allocator, memory is only released all at once
+ *
+ * Memory is carved out of large blocks, objects created with create()
+ * are destroyed in reverse order of creation by clear() or by the
+ * destructor of the arena.
+ */
+class Arena
+{
+public:
+    explicit Arena(std::size_t block_size = 4096)
+        : block_size(block_size)
+    {}
+
+    Arena(Arena&& other) noexcept
+        : block_size(other.block_size),
+          blocks(other.blocks),
+          finalizers(other.finalizers),
+          position(other.position),
+          end(other.end),
+          reserved(other.reserved)
+    {
+        other.blocks = nullptr;
+        other.finalizers = nullptr;
+        other.position = other.end = nullptr;
+        other.reserved = 0;
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena()
+    {
+        clear();
+    }
+
+    /**
+     * \brief Returns uninitialized memory
+     * \param align Must be a power of two
+     */
+    void* allocate(std::size_t size, std::size_t align = alignof(std::max_align_t))
+    {
+        if ( char* result = bump(size, align) )
+            return result;
+
+        std::size_t needed = sizeof(Block) + size + align;
+        std::size_t allocation = needed > block_size ? needed : block_size;
+        Block* block = static_cast<Block*>(::operator new(allocation));
+        block->next = blocks;
+        blocks = block;
+        reserved += allocation;
+
+        // Oversized requests don't replace the current block
+        if ( allocation != block_size && position )
+            return align_up(reinterpret_cast<char*>(block + 1), align);
+
+        position = reinterpret_cast<char*>(block + 1);
+        end = reinterpret_cast<char*>(block) + allocation;
+        return bump(size, align);
+    }
+
+    /**
+     * \brief Constructs an object in the arena
+     */
+    template<class T, class... Args>
+        T* create(Args&&... args)
+    {
+        Finalizer* finalizer = nullptr;
+        if ( !std::is_trivially_destructible<T>::value )
+            finalizer = static_cast<Finalizer*>(allocate(sizeof(Finalizer), alignof(Finalizer)));
+
+        T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+        if ( finalizer )
+        {
+            finalizer->destroy = &destroy<T>;
+            finalizer->object = object;
+            finalizer->next = finalizers;
+            finalizers = finalizer;
+        }
+        return object;
+    }
+
+    /**
+     * \brief Destroys all the objects and releases all the memory
+     */
+    void clear()
+    {
+        while ( finalizers )
+        {
+            Finalizer* finalizer = finalizers;
+            finalizers = finalizer->next;
+            finalizer->destroy(finalizer->object);
+        }
+
+        while ( blocks )
+        {
+            Block* block = blocks;
+            blocks = block->next;
+            ::operator delete(block);
+        }
+
+        position = end = nullptr;
+        reserved = 0;
+    }
+
+    /**
+     * \brief Number of bytes obtained from the system
+     */
+    std::size_t reserved_size() const
+    {
+        return reserved;
+    }
+
+private:
+    struct Block
+    {
+        Block* next;
+        std::max_align_t align;
+    };
+
+    struct Finalizer
+    {
+        void (*destroy)(void*);
+        void* object;
+        Finalizer* next;
+    };
+
+    template<class T>
+        static void destroy(void* object)
+    {
+        static_cast<T*>(object)->~T();
+    }
+
+    static char* align_up(char* pointer, std::size_t align)
+    {
+        auto address = reinterpret_cast<std::uintptr_t>(pointer);
+        return pointer + ((align - address % align) % align);
+    }
+
+    /**
+     * \brief Allocates from the current block
+     * \returns \b nullptr if it doesn't fit
+     */
+    char* bump(std::size_t size, std::size_t align)
+    {
+        if ( !position )
+            return nullptr;
+        char* result = align_up(position, align);
+        if ( result > end || std::size_t(end - result) < size )
+            return nullptr;
+        position = result + size;
+        return result;
+    }
+
+    std::size_t block_size;
+    Block* blocks = nullptr;
+    Finalizer* finalizers = nullptr;
+    char* position = nullptr;
+    char* end = nullptr;
+    std::size_t reserved = 0;
+};
+
+} // namespace httpony
+#endif // HTTPONY_ARENA_HPP
@@ -0,0 +1,214 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTPONY_ESCAPE_HPP
+#define HTTPONY_ESCAPE_HPP
+
+/// \cond
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#if defined(__SSE2__)
+#   include <emmintrin.h>
+#endif
+/// \endcond
+
+namespace httpony {
+namespace escape {
+
+namespace detail {
+
+    /**
+     * \brief Whether \p c needs escaping in XML text or attribute values
+     */
+    constexpr bool is_xml_special(char c)
+    {
+        return c == '<' || c == '>' || c == '&' || c == '"' || c == '\'';
+    }
+
+    /**
+     * \brief Finds the first XML special character checking one at a time
+     */
+    inline const char* find_xml_special_scalar(const char* begin, const char* end)
+    {
+        for ( ; begin != end; ++begin )
+            if ( is_xml_special(*begin) )
+                return begin;
+        return end;
+    }
+
+#if defined(__SSE2__)
+    /**
+     * \brief Finds the first XML special character checking 16 at a time
+     */
+    inline const char* find_xml_special_simd(const char* begin, const char* end)
+    {
+        const __m128i lt = _mm_set1_epi8('<');
+        const __m128i gt = _mm_set1_epi8('>');
+        const __m128i amp = _mm_set1_epi8('&');
+        const __m128i quot = _mm_set1_epi8('"');
+        const __m128i apos = _mm_set1_epi8('\'');
+
+        for ( ; end - begin >= 16; begin += 16 )
+        {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+            __m128i special = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, lt), _mm_cmpeq_epi8(chunk, gt)),
+                _mm_or_si128(
+                    _mm_cmpeq_epi8(chunk, amp),
+                    _mm_or_si128(_mm_cmpeq_epi8(chunk, quot), _mm_cmpeq_epi8(chunk, apos))
+                )
+            );
+            if ( int mask = _mm_movemask_epi8(special) )
+                return begin + __builtin_ctz(mask);
+        }
+        return find_xml_special_scalar(begin, end);
+    }
+#   define HTTPONY_ESCAPE_SIMD 1
+#endif
+
+    /**
+     * \brief Entity replacing an XML special character
+     */
+    inline const char* xml_entity(char c, std::size_t& size)
+    {
+        switch ( c )
+        {
+            case '"':  size = 6; return "&quot;";
+            case '\'': size = 6; return "&apos;";
+            case '&':  size = 5; return "&amp;";
+            case '<':  size = 4; return "&lt;";
+            default:   size = 4; return "&gt;";
+        }
+    }
+
+} // namespace detail
+
+/**
+ * \brief Returns a pointer to the first character in [begin, end)
+ * which needs escaping in XML, or \p end
+ */
+inline const char* find_xml_special(const char* begin, const char* end)
+{
+#ifdef HTTPONY_ESCAPE_SIMD
+    return detail::find_xml_special_simd(begin, end);
+#else
+    return detail::find_xml_special_scalar(begin, end);
+#endif
+}
+
+/**
+ * \brief Escapes XML special characters, passing the output to \p write
+ *
+ * \p write is called as <tt>write(const char* data, std::size_t size)</tt>,
+ * with runs of characters which don't need escaping passed as a whole.
+ */
+template<class Writer>
+    void xml(const char* data, std::size_t size, Writer&& write)
+{
+    const char* end = data + size;
+    while ( true )
+    {
+        const char* special = find_xml_special(data, end);
+        if ( special != data )
+            write(data, std::size_t(special - data));
+        if ( special == end )
+            break;
+        std::size_t entity_size;
+        const char* entity = detail::xml_entity(*special, entity_size);
+        write(entity, entity_size);
+        data = special + 1;
+    }
+}
+
+/**
+ * \brief Appends \p string to \p output escaping XML special characters
+ */
+inline void xml_append(std::string& output, const std::string& string)
+{
+    xml(string.data(), string.size(), [&output](const char* data, std::size_t size) {
+        output.append(data, size);
+    });
+}
+
+/**
+ * \brief Writes \p string to \p out escaping XML special characters
+ */
+inline void xml(std::ostream& out, const std::string& string)
+{
+    xml(string.data(), string.size(), [&out](const char* data, std::size_t size) {
+        out.write(data, size);
+    });
+}
+
+/**
+ * \brief Returns \p string with XML special characters escaped
+ */
+inline std::string xml(const std::string& string)
+{
+    const char* special = find_xml_special(string.data(), string.data() + string.size());
+    if ( special == string.data() + string.size() )
+        return string;
+
+    std::string output;
+    output.reserve(string.size() + string.size() / 8 + 8);
+    output.append(string.data(), special);
+    xml(special, string.size() - (special - string.data()),
+        [&output](const char* data, std::size_t size) {
+            output.append(data, size);
+    });
+    return output;
+}
+
+/**
+ * \brief Escapes JSON text so it can be embedded in a HTML script element
+ *
+ * \p json must be valid JSON, \c <, \c > and \c & can only appear inside
+ * strings so they are replaced with unicode escapes.
+ */
+inline std::string script_json(const std::string& json)
+{
+    std::string output;
+    output.reserve(json.size());
+    const char* data = json.data();
+    const char* end = data + json.size();
+    while ( true )
+    {
+        const char* special = find_xml_special(data, end);
+        output.append(data, special);
+        if ( special == end )
+            break;
+        switch ( *special )
+        {
+            case '<': output += "\\u003c"; break;
+            case '>': output += "\\u003e"; break;
+            case '&': output += "\\u0026"; break;
+            default:  output += *special; break;
+        }
+        data = special + 1;
+    }
+    return output;
+}
+
+} // namespace escape
+} // namespace httpony
+#endif // HTTPONY_ESCAPE_HPP
@@ -0,0 +1,214 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef HTTPONY_LRU_CACHE_HPP
+#define HTTPONY_LRU_CACHE_HPP
+
+/// \cond
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+/// \endcond
+
+namespace httpony {
+
+/**
+ * \brief Map which discards the least recently used entries once full
+ * \note Not thread safe, see ShardedLruCache for that
+ */
+template<class Key, class Value, class Hash = std::hash<Key>>
+    class LruCache
+{
+public:
+    explicit LruCache(std::size_t capacity)
+        : _capacity(capacity ? capacity : 1)
+    {}
+
+    /**
+     * \brief Returns a pointer to the cached value or \b nullptr
+     *
+     * The entry becomes the most recently used one
+     */
+    Value* find(const Key& key)
+    {
+        auto iter = index.find(key);
+        if ( iter == index.end() )
+            return nullptr;
+        entries.splice(entries.begin(), entries, iter->second);
+        return &iter->second->second;
+    }
+
+    /**
+     * \brief Inserts or replaces a value, discarding the oldest entry if needed
+     */
+    Value& insert(const Key& key, Value value)
+    {
+        auto iter = index.find(key);
+        if ( iter != index.end() )
+        {
+            entries.splice(entries.begin(), entries, iter->second);
+            iter->second->second = std::move(value);
+            return iter->second->second;
+        }
+
+        if ( entries.size() >= _capacity )
+        {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+
+        entries.emplace_front(key, std::move(value));
+        index.emplace(key, entries.begin());
+        return entries.front().second;
+    }
+
+    void clear()
+    {
+        index.clear();
+        entries.clear();
+    }
+
+    std::size_t size() const
+    {
+        return entries.size();
+    }
+
+    std::size_t capacity() const
+    {
+        return _capacity;
+    }
+
+    /**
+     * \brief Changes the capacity, discarding the oldest entries if needed
+     */
+    void set_capacity(std::size_t capacity)
+    {
+        _capacity = capacity ? capacity : 1;
+        while ( entries.size() > _capacity )
+        {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+    }
+
+private:
+    using Entries = std::list<std::pair<Key, Value>>;
+
+    std::size_t _capacity;
+    Entries entries;    ///< Most recently used first
+    std::unordered_map<Key, typename Entries::iterator, Hash> index;
+};
+
+/**
+ * \brief Thread safe LRU cache
+ *
+ * Keys are distributed among independent shards, each with its own lock,
+ * so concurrent lookups of different keys seldom wait for each other.
+ * Each shard discards its own least recently used entries.
+ */
+template<class Key, class Value, class Hash = std::hash<Key>>
+    class ShardedLruCache
+{
+public:
+    /**
+     * \param capacity  Maximum total number of entries
+     * \param shards    Number of independent shards
+     */
+    explicit ShardedLruCache(std::size_t capacity, std::size_t shards = 16)
+    {
+        if ( shards == 0 )
+            shards = 1;
+        std::size_t shard_capacity = (capacity + shards - 1) / shards;
+        _shards.reserve(shards);
+        for ( std::size_t i = 0; i < shards; i++ )
+            _shards.emplace_back(new Shard(shard_capacity));
+    }
+
+    /**
+     * \brief Returns the cached value for \p key, calling
+     * \p create(key) to obtain it if it isn't cached
+     *
+     * \p create is called without holding any lock, so concurrent misses
+     * for the same key might call it more than once.
+     */
+    template<class Create>
+        Value get(const Key& key, Create&& create)
+    {
+        Shard& shard = shard_for(key);
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if ( Value* value = shard.cache.find(key) )
+                return *value;
+        }
+
+        Value value = create(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.cache.insert(key, std::move(value));
+    }
+
+    void clear()
+    {
+        for ( auto& shard : _shards )
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            shard->cache.clear();
+        }
+    }
+
+    std::size_t size() const
+    {
+        std::size_t total = 0;
+        for ( auto& shard : _shards )
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            total += shard->cache.size();
+        }
+        return total;
+    }
+
+private:
+    struct Shard
+    {
+        explicit Shard(std::size_t capacity)
+            : cache(capacity)
+        {}
+
+        LruCache<Key, Value, Hash> cache;
+        mutable std::mutex mutex;
+    };
+
+    Shard& shard_for(const Key& key)
+    {
+        std::size_t hash = Hash()(key);
+        // Mix the high bits in so the shards don't just follow the map buckets
+        hash ^= hash >> 16;
+        return *_shards[hash % _shards.size()];
+    }
+
+    std::vector<std::unique_ptr<Shard>> _shards;
+};
+
+} // namespace httpony
+#endif // HTTPONY_LRU_CACHE_HPP
@@ -0,0 +1,589 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTPONY_NUMBER_FORMAT_HPP
+#define HTTPONY_NUMBER_FORMAT_HPP
+
+/// \cond
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+/// \endcond
+
+namespace httpony {
+namespace number {
+
+/**
+ * \brief Buffer size large enough for any output of format_integer()
+ */
+constexpr std::size_t max_integer_size = 21;
+
+/**
+ * \brief Buffer size large enough for any output of format_double()
+ */
+constexpr std::size_t max_double_size = 26;
+
+namespace detail {
+
+    /**
+     * \brief Decimal digits in pairs, "00" to "99"
+     */
+    inline const char* digit_pairs()
+    {
+        static const char pairs[] =
+            "00010203040506070809"
+            "10111213141516171819"
+            "20212223242526272829"
+            "30313233343536373839"
+            "40414243444546474849"
+            "50515253545556575859"
+            "60616263646566676869"
+            "70717273747576777879"
+            "80818283848586878889"
+            "90919293949596979899";
+        return pairs;
+    }
+
+    /**
+     * \brief Writes \p value right-aligned so that it ends at \p end
+     * \returns Pointer to the first written character
+     */
+    inline char* format_digits_backwards(char* end, uint64_t value)
+    {
+        const char* pairs = digit_pairs();
+        while ( value >= 100 )
+        {
+            unsigned index = unsigned(value % 100) * 2;
+            value /= 100;
+            end -= 2;
+            std::memcpy(end, pairs + index, 2);
+        }
+        if ( value >= 10 )
+        {
+            end -= 2;
+            std::memcpy(end, pairs + value * 2, 2);
+        }
+        else
+        {
+            *--end = char('0' + value);
+        }
+        return end;
+    }
+
+    /**
+     * \brief Floating point number with a 64 bit significand
+     */
+    struct DiyFp
+    {
+        uint64_t f = 0;
+        int e = 0;
+
+        constexpr DiyFp() = default;
+        constexpr DiyFp(uint64_t f, int e) : f(f), e(e) {}
+
+        DiyFp operator-(const DiyFp& other) const
+        {
+            return DiyFp(f - other.f, e);
+        }
+
+        /**
+         * \brief Product rounded to the upper 64 bits
+         */
+        DiyFp operator*(const DiyFp& other) const
+        {
+            const uint64_t mask = 0xFFFFFFFFu;
+            uint64_t a = f >> 32, b = f & mask;
+            uint64_t c = other.f >> 32, d = other.f & mask;
+            uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+            uint64_t mid = (bd >> 32) + (ad & mask) + (bc & mask);
+            mid += 1u << 31;
+            return DiyFp(ac + (ad >> 32) + (bc >> 32) + (mid >> 32), e + other.e + 64);
+        }
+
+        DiyFp normalized() const
+        {
+            DiyFp result = *this;
+            while ( !(result.f & (uint64_t(1) << 63)) )
+            {
+                result.f <<= 1;
+                result.e--;
+            }
+            return result;
+        }
+
+        DiyFp normalized_to(int exponent) const
+        {
+            return DiyFp(f << (e - exponent), exponent);
+        }
+    };
+
+    struct CachedPower
+    {
+        uint64_t f;
+        int e;
+        int k;
+    };
+
+    /**
+     * \brief Normalized powers of ten from 10^-300 to 10^324 in steps of 8
+     */
+    inline const CachedPower& cached_power(int index)
+    {
+        static const CachedPower powers[] = {
+            { 0xAB70FE17C79AC6CAull, -1060, -300 },
+            { 0xFF77B1FCBEBCDC4Full, -1034, -292 },
+            { 0xBE5691EF416BD60Cull, -1007, -284 },
+            { 0x8DD01FAD907FFC3Cull,  -980, -276 },
+            { 0xD3515C2831559A83ull,  -954, -268 },
+            { 0x9D71AC8FADA6C9B5ull,  -927, -260 },
+            { 0xEA9C227723EE8BCBull,  -901, -252 },
+            { 0xAECC49914078536Dull,  -874, -244 },
+            { 0x823C12795DB6CE57ull,  -847, -236 },
+            { 0xC21094364DFB5637ull,  -821, -228 },
+            { 0x9096EA6F3848984Full,  -794, -220 },
+            { 0xD77485CB25823AC7ull,  -768, -212 },
+            { 0xA086CFCD97BF97F4ull,  -741, -204 },
+            { 0xEF340A98172AACE5ull,  -715, -196 },
+            { 0xB23867FB2A35B28Eull,  -688, -188 },
+            { 0x84C8D4DFD2C63F3Bull,  -661, -180 },
+            { 0xC5DD44271AD3CDBAull,  -635, -172 },
+            { 0x936B9FCEBB25C996ull,  -608, -164 },
+            { 0xDBAC6C247D62A584ull,  -582, -156 },
+            { 0xA3AB66580D5FDAF6ull,  -555, -148 },
+            { 0xF3E2F893DEC3F126ull,  -529, -140 },
+            { 0xB5B5ADA8AAFF80B8ull,  -502, -132 },
+            { 0x87625F056C7C4A8Bull,  -475, -124 },
+            { 0xC9BCFF6034C13053ull,  -449, -116 },
+            { 0x964E858C91BA2655ull,  -422, -108 },
+            { 0xDFF9772470297EBDull,  -396, -100 },
+            { 0xA6DFBD9FB8E5B88Full,  -369,  -92 },
+            { 0xF8A95FCF88747D94ull,  -343,  -84 },
+            { 0xB94470938FA89BCFull,  -316,  -76 },
+            { 0x8A08F0F8BF0F156Bull,  -289,  -68 },
+            { 0xCDB02555653131B6ull,  -263,  -60 },
+            { 0x993FE2C6D07B7FACull,  -236,  -52 },
+            { 0xE45C10C42A2B3B06ull,  -210,  -44 },
+            { 0xAA242499697392D3ull,  -183,  -36 },
+            { 0xFD87B5F28300CA0Eull,  -157,  -28 },
+            { 0xBCE5086492111AEBull,  -130,  -20 },
+            { 0x8CBCCC096F5088CCull,  -103,  -12 },
+            { 0xD1B71758E219652Cull,   -77,   -4 },
+            { 0x9C40000000000000ull,   -50,    4 },
+            { 0xE8D4A51000000000ull,   -24,   12 },
+            { 0xAD78EBC5AC620000ull,     3,   20 },
+            { 0x813F3978F8940984ull,    30,   28 },
+            { 0xC097CE7BC90715B3ull,    56,   36 },
+            { 0x8F7E32CE7BEA5C70ull,    83,   44 },
+            { 0xD5D238A4ABE98068ull,   109,   52 },
+            { 0x9F4F2726179A2245ull,   136,   60 },
+            { 0xED63A231D4C4FB27ull,   162,   68 },
+            { 0xB0DE65388CC8ADA8ull,   189,   76 },
+            { 0x83C7088E1AAB65DBull,   216,   84 },
+            { 0xC45D1DF942711D9Aull,   242,   92 },
+            { 0x924D692CA61BE758ull,   269,  100 },
+            { 0xDA01EE641A708DEAull,   295,  108 },
+            { 0xA26DA3999AEF774Aull,   322,  116 },
+            { 0xF209787BB47D6B85ull,   348,  124 },
+            { 0xB454E4A179DD1877ull,   375,  132 },
+            { 0x865B86925B9BC5C2ull,   402,  140 },
+            { 0xC83553C5C8965D3Dull,   428,  148 },
+            { 0x952AB45CFA97A0B3ull,   455,  156 },
+            { 0xDE469FBD99A05FE3ull,   481,  164 },
+            { 0xA59BC234DB398C25ull,   508,  172 },
+            { 0xF6C69A72A3989F5Cull,   534,  180 },
+            { 0xB7DCBF5354E9BECEull,   561,  188 },
+            { 0x88FCF317F22241E2ull,   588,  196 },
+            { 0xCC20CE9BD35C78A5ull,   614,  204 },
+            { 0x98165AF37B2153DFull,   641,  212 },
+            { 0xE2A0B5DC971F303Aull,   667,  220 },
+            { 0xA8D9D1535CE3B396ull,   694,  228 },
+            { 0xFB9B7CD9A4A7443Cull,   720,  236 },
+            { 0xBB764C4CA7A44410ull,   747,  244 },
+            { 0x8BAB8EEFB6409C1Aull,   774,  252 },
+            { 0xD01FEF10A657842Cull,   800,  260 },
+            { 0x9B10A4E5E9913129ull,   827,  268 },
+            { 0xE7109BFBA19C0C9Dull,   853,  276 },
+            { 0xAC2820D9623BF429ull,   880,  284 },
+            { 0x80444B5E7AA7CF85ull,   907,  292 },
+            { 0xBF21E44003ACDD2Dull,   933,  300 },
+            { 0x8E679C2F5E44FF8Full,   960,  308 },
+            { 0xD433179D9C8CB841ull,   986,  316 },
+            { 0x9E19DB92B4E31BA9ull,  1013,  324 },
+        };
+        return powers[index];
+    }
+
+    /**
+     * \brief Finds a power of ten that brings a number with binary
+     * exponent \p e in the range [-60, -32]
+     */
+    inline const CachedPower& cached_power_for_exponent(int e)
+    {
+        constexpr int alpha = -60;
+        constexpr int min_exponent = -300;
+        constexpr int step = 8;
+        // ceil(log10(2^(alpha - e - 1)))
+        int f = alpha - e - 1;
+        int k = (f * 78913) / (1 << 18) + (f > 0);
+        return cached_power((-min_exponent + k + (step - 1)) / step);
+    }
+
+    /**
+     * \brief Largest power of ten not greater than \p n
+     * \returns The number of decimal digits of \p n
+     */
+    inline int largest_pow10(uint32_t n, uint32_t& pow10)
+    {
+        static const uint32_t powers[] = {
+            1, 10, 100, 1000, 10000, 100000, 1000000,
+            10000000, 100000000, 1000000000
+        };
+        int digits = 10;
+        while ( digits > 1 && n < powers[digits - 1] )
+            digits--;
+        pow10 = powers[digits - 1];
+        return digits;
+    }
+
+    /**
+     * \brief Moves the last digit closer to the exact value
+     * \returns \b false if the digits can't be proven to be the closest
+     * ones within the boundaries
+     *
+     * All the distances are scaled and only known up to \p unit.
+     */
+    inline bool grisu_round_weed(char* buffer, int length, uint64_t distance_too_high,
+                                 uint64_t unsafe_interval, uint64_t rest,
+                                 uint64_t ten_kappa, uint64_t unit)
+    {
+        uint64_t small_distance = distance_too_high - unit;
+        uint64_t big_distance = distance_too_high + unit;
+
+        while ( rest < small_distance && unsafe_interval - rest >= ten_kappa &&
+                ( rest + ten_kappa < small_distance ||
+                  small_distance - rest >= rest + ten_kappa - small_distance ) )
+        {
+            buffer[length - 1]--;
+            rest += ten_kappa;
+        }
+
+        // Another digit could be closer given the imprecision
+        if ( rest < big_distance && unsafe_interval - rest >= ten_kappa &&
+             ( rest + ten_kappa < big_distance ||
+               big_distance - rest > rest + ten_kappa - big_distance ) )
+            return false;
+
+        // The digits might fall outside of the boundaries
+        return 2 * unit <= rest && rest <= unsafe_interval - 4 * unit;
+    }
+
+    /**
+     * \brief Generates the shortest digits within (low, high)
+     * \returns \b false if the result can't be proven correct
+     */
+    inline bool grisu_digits(char* buffer, int& length, int& exponent,
+                             DiyFp low, DiyFp value, DiyFp high)
+    {
+        // The scaled boundaries are off by at most one unit in either direction
+        uint64_t unit = 1;
+        DiyFp too_low(low.f - unit, low.e);
+        DiyFp too_high(high.f + unit, high.e);
+        uint64_t unsafe_interval = (too_high - too_low).f;
+
+        DiyFp one(uint64_t(1) << -high.e, high.e);
+        uint32_t integral = uint32_t(too_high.f >> -one.e);
+        uint64_t fractional = too_high.f & (one.f - 1);
+
+        uint32_t pow10;
+        int remaining = largest_pow10(integral, pow10);
+        length = 0;
+
+        while ( remaining > 0 )
+        {
+            uint32_t digit = integral / pow10;
+            integral %= pow10;
+            buffer[length++] = char('0' + digit);
+            remaining--;
+
+            uint64_t rest = (uint64_t(integral) << -one.e) + fractional;
+            if ( rest < unsafe_interval )
+            {
+                exponent += remaining;
+                return grisu_round_weed(buffer, length, (too_high - value).f,
+                    unsafe_interval, rest, uint64_t(pow10) << -one.e, unit);
+            }
+            pow10 /= 10;
+        }
+
+        while ( true )
+        {
+            fractional *= 10;
+            unit *= 10;
+            unsafe_interval *= 10;
+            buffer[length++] = char('0' + (fractional >> -one.e));
+            fractional &= one.f - 1;
+            exponent--;
+            if ( fractional < unsafe_interval )
+                return grisu_round_weed(buffer, length, (too_high - value).f * unit,
+                    unsafe_interval, fractional, one.f, unit);
+        }
+    }
+
+    /**
+     * \brief Grisu3 algorithm by Florian Loitsch
+     *
+     * Writes the shortest significant digits of a positive finite \p value
+     * and its decimal exponent.
+     * \returns \b false for the few values (about 0.5%) where the result
+     * can't be proven to be the shortest
+     */
+    inline bool grisu3(double value, char* buffer, int& length, int& exponent)
+    {
+        constexpr int significand_bits = 52;
+        constexpr uint64_t hidden_bit = uint64_t(1) << significand_bits;
+        constexpr int bias = 1023 + significand_bits;
+
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        int biased_exponent = int(bits >> significand_bits);
+        uint64_t significand = bits & (hidden_bit - 1);
+
+        DiyFp v = biased_exponent == 0
+            ? DiyFp(significand, 1 - bias)
+            : DiyFp(significand + hidden_bit, biased_exponent - bias);
+
+        // Boundaries halfway to the neighbouring doubles
+        bool lower_closer = significand == 0 && biased_exponent > 1;
+        DiyFp high = DiyFp(2 * v.f + 1, v.e - 1).normalized();
+        DiyFp low = lower_closer
+            ? DiyFp(4 * v.f - 1, v.e - 2)
+            : DiyFp(2 * v.f - 1, v.e - 1);
+        low = low.normalized_to(high.e);
+        v = v.normalized();
+
+        const CachedPower& cached = cached_power_for_exponent(high.e);
+        DiyFp power(cached.f, cached.e);
+
+        exponent = -cached.k;
+        return grisu_digits(buffer, length, exponent, low * power, v * power, high * power);
+    }
+
+    /**
+     * \brief Whether \p length digits times 10^\p exponent read back as \p value
+     */
+    inline bool digits_round_trip(double value, const char* buffer, int length, int exponent)
+    {
+        char formatted[32];
+        std::snprintf(formatted, sizeof(formatted), "%.*se%d", length, buffer, exponent);
+        return std::strtod(formatted, nullptr) == value;
+    }
+
+    /**
+     * \brief Slow but exact fallback for grisu3()
+     *
+     * Tries increasing precisions of the correctly rounded printf output
+     * until one reads back to \p value.
+     */
+    inline void exact_digits(double value, char* buffer, int& length, int& exponent)
+    {
+        char formatted[32];
+        for ( int precision = 0; ; precision++ )
+        {
+            std::snprintf(formatted, sizeof(formatted), "%.*e", precision, value);
+            length = 0;
+            const char* iter = formatted;
+            for ( ; *iter != 'e'; iter++ )
+                if ( *iter >= '0' && *iter <= '9' )
+                    buffer[length++] = *iter;
+            exponent = std::atoi(iter + 1) - precision;
+
+            if ( precision == 16 || digits_round_trip(value, buffer, length, exponent) )
+                break;
+
+            // Powers of two are closer to the lower neighbour, so the
+            // digits above can fit when the nearest ones below don't
+            int index = length - 1;
+            while ( index >= 0 && buffer[index] == '9' )
+                buffer[index--] = '0';
+            if ( index < 0 )
+            {
+                buffer[0] = '1';
+                exponent++;
+            }
+            else
+            {
+                buffer[index]++;
+            }
+            if ( digits_round_trip(value, buffer, length, exponent) )
+                break;
+        }
+
+        while ( length > 1 && buffer[length - 1] == '0' )
+        {
+            length--;
+            exponent++;
+        }
+    }
+
+} // namespace detail
+
+/**
+ * \brief Writes the decimal representation of \p value into \p buffer
+ * \returns Pointer past the last written character
+ */
+inline char* format_integer(char* buffer, unsigned long long value)
+{
+    char digits[max_integer_size];
+    char* end = digits + sizeof(digits);
+    char* begin = detail::format_digits_backwards(end, value);
+    std::memcpy(buffer, begin, end - begin);
+    return buffer + (end - begin);
+}
+
+inline char* format_integer(char* buffer, long long value)
+{
+    unsigned long long magnitude = value;
+    if ( value < 0 )
+    {
+        *buffer++ = '-';
+        magnitude = 0 - magnitude;
+    }
+    return format_integer(buffer, magnitude);
+}
+
+/**
+ * \brief Writes the shortest representation of \p value that reads back
+ * to the same double
+ *
+ * Numbers with a decimal exponent in [-6, 21) are written in fixed
+ * notation, the others in exponential notation (like JavaScript does).
+ * Non-finite values are written as "nan", "inf" and "-inf".
+ *
+ * \returns Pointer past the last written character
+ */
+inline char* format_double(char* buffer, double value)
+{
+    if ( std::isnan(value) )
+    {
+        std::memcpy(buffer, "nan", 3);
+        return buffer + 3;
+    }
+
+    if ( std::signbit(value) )
+    {
+        *buffer++ = '-';
+        value = -value;
+    }
+
+    if ( std::isinf(value) )
+    {
+        std::memcpy(buffer, "inf", 3);
+        return buffer + 3;
+    }
+
+    if ( value == 0 )
+    {
+        *buffer++ = '0';
+        return buffer;
+    }
+
+    char digits[18];
+    int length;
+    int exponent;
+    if ( !detail::grisu3(value, digits, length, exponent) )
+        detail::exact_digits(value, digits, length, exponent);
+
+    // Position of the decimal point relative to the first digit
+    int point = length + exponent;
+
+    if ( length <= point && point <= 21 )
+    {
+        // 1234e7 -> 12340000000
+        std::memcpy(buffer, digits, length);
+        std::memset(buffer + length, '0', point - length);
+        return buffer + point;
+    }
+
+    if ( 0 < point && point <= 21 )
+    {
+        // 1234e-2 -> 12.34
+        std::memcpy(buffer, digits, point);
+        buffer[point] = '.';
+        std::memcpy(buffer + point + 1, digits + point, length - point);
+        return buffer + length + 1;
+    }
+
+    if ( -6 < point && point <= 0 )
+    {
+        // 1234e-6 -> 0.001234
+        buffer[0] = '0';
+        buffer[1] = '.';
+        std::memset(buffer + 2, '0', -point);
+        std::memcpy(buffer + 2 - point, digits, length);
+        return buffer + 2 - point + length;
+    }
+
+    // 1234e30 -> 1.234e+33
+    *buffer++ = digits[0];
+    if ( length > 1 )
+    {
+        *buffer++ = '.';
+        std::memcpy(buffer, digits + 1, length - 1);
+        buffer += length - 1;
+    }
+    *buffer++ = 'e';
+    int decimal_exponent = point - 1;
+    if ( decimal_exponent < 0 )
+    {
+        *buffer++ = '-';
+        decimal_exponent = -decimal_exponent;
+    }
+    else
+    {
+        *buffer++ = '+';
+    }
+    return format_integer(buffer, (unsigned long long)decimal_exponent);
+}
+
+inline std::string to_string(double value)
+{
+    char buffer[max_double_size];
+    return std::string(buffer, format_double(buffer, value));
+}
+
+inline std::string to_string(long long value)
+{
+    char buffer[max_integer_size];
+    return std::string(buffer, format_integer(buffer, value));
+}
+
+inline std::string to_string(unsigned long long value)
+{
+    char buffer[max_integer_size];
+    return std::string(buffer, format_integer(buffer, value));
+}
+
+} // namespace number
+} // namespace httpony
+#endif // HTTPONY_NUMBER_FORMAT_HPP
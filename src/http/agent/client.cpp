@@ -44,9 +44,28 @@ OperationStatus Client::get_response_attempt(int attempt, Request& request, Resp
 
     {
         process_request(request);
-        auto ostream = request.connection.send_stream();
-        Http1Formatter().request(ostream, request);
-        auto status = ostream.send();
+
+        // Cookies from the jar are only added while sending, so they
+        // don't carry over to a redirect target
+        DataMap request_cookies = request.cookies;
+        _cookie_jar.select(request.uri, request.cookies);
+
+        OperationStatus status;
+        if ( request.body.has_output() )
+        {
+            // Large parts of the body are sent without copying them
+            auto ostream = request.connection.send_stream();
+            Http1Formatter().request_head(ostream, request);
+            status = request.connection.write(request.body.output().gather());
+        }
+        else
+        {
+            auto ostream = request.connection.send_stream();
+            Http1Formatter().request(ostream, request);
+            status = ostream.send();
+        }
+
+        request.cookies = std::move(request_cookies);
         if ( status.error() )
         {
             response.clear_data();
@@ -67,6 +86,8 @@ OperationStatus Client::get_response_attempt(int attempt, Request& request, Resp
             return status;
     }
 
+    _cookie_jar.store(request.uri, response.cookies);
+
     response.connection.input_buffer().expect_input(
         response.body.has_data() ?
         response.body.content_length() :
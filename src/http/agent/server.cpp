@@ -85,6 +85,13 @@ void Server::start()
 void Server::on_connection(io::Connection& connection)
 {
     /// \todo lock, copy _max_request_size and unlock
+    // Checked here rather than in accept() so overrides can't skip it
+    if ( !_access_list.allowed(connection.remote_binary_address()) )
+    {
+        error(connection, "address not allowed");
+        return;
+    }
+
     auto accepted = accept(connection);
     if ( !accepted )
     {
@@ -92,6 +99,10 @@ void Server::on_connection(io::Connection& connection)
         return;
     }
 
+    connection.memory_account().attach(&_memory_budget);
+    // Blocking the listening thread would stall every other connection
+    connection.memory_account().set_can_wait(std::this_thread::get_id() != _listen_thread);
+
     /// \todo Switch parser based on protocol
     connection.input_buffer().expect_input(_max_request_size);
 
@@ -112,10 +123,24 @@ void Server::on_connection(io::Connection& connection)
         {
             status = httpony::StatusCode::PayloadTooLarge;
         }
+        else if ( !connection.memory_account().update(
+                    io::MemoryAccount::Body, request.body.content_length()) )
+        {
+            status = httpony::StatusCode::ServiceUnavailable;
+        }
     }
 
     request.connection = connection;
-    respond(request, status);
+    // Connections marked while parsing are dropped, instead of holding
+    // their memory for the whole response
+    if ( !connection.memory_account().shed() )
+        respond(request, status);
+    else
+        error(connection, "connection dropped to reduce memory usage");
+
+    connection.memory_account().set(io::MemoryAccount::Body, 0);
+    if ( connection.memory_account().shed() )
+        connection.close();
 }
 
 bool Server::run()
@@ -137,6 +162,7 @@ void Server::run_init()
 
 void Server::run_body()
 {
+    _listen_thread = std::this_thread::get_id();
     _listen_server.run(
         [this](io::Connection& connection){
             on_connection(connection);
@@ -179,10 +205,10 @@ void Server::process_log_format(
             break;
         case 'h': // Remote host
         case 'a': // Remote IP-address
-            output << request.connection.remote_address().string;
+            output << request.connection.remote_address_string();
             break;
         case 'A': // Local IP-address
-            output << request.connection.local_address().string;
+            output << request.connection.local_address_string();
             break;
         case 'B': // Size of response in bytes, excluding HTTP headers.
             output << response.body.content_length();
@@ -225,9 +251,9 @@ void Server::process_log_format(
             break;
         case 'p':
             if ( argument == "remote" )
-                output << request.connection.remote_address().port;
+                output << request.connection.remote_binary_address().port;
             else if ( argument == "local" )
-                output << request.connection.local_address().port;
+                output << request.connection.local_binary_address().port;
             else // canonical
                 output << listen_address().port;
             break;
@@ -351,11 +377,28 @@ OperationStatus Server::send(Response& response) const
 {
     if ( !response.connection )
         return "invalid connection";
+
+    io::MemoryAccount& memory = response.connection.memory_account();
+    if ( memory.shed() )
+    {
+        response.connection.close();
+        return "connection dropped to reduce memory usage";
+    }
+
+    // The body is charged until it has been written to the socket
+    if ( !memory.update(io::MemoryAccount::Response, response.body.content_length()) )
+    {
+        response.body.stop_output();
+        response.status = StatusCode::ServiceUnavailable;
+    }
+
     auto stream = response.connection.send_stream();
     /// \todo Switch formatter based on protocol
     /// (Needs to implement stuff like HTTP/2)
     Http1Formatter().response(stream, response);
-    return stream.send();
+    auto status = stream.send();
+    memory.set(io::MemoryAccount::Response, 0);
+    return status;
 }
 
 } // namespace httpony
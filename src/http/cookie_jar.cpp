@@ -0,0 +1,277 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "httpony/http/cookie_jar.hpp"
+
+/// \cond
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+/// \endcond
+
+namespace httpony {
+
+/**
+ * \brief Multi-label public suffixes, sorted
+ *
+ * Only a selection of the most common ones from the Public Suffix List
+ * \see https://publicsuffix.org/
+ */
+static const char* const multi_label_suffixes[] = {
+    "ac.jp", "ac.nz", "ac.uk", "ac.za",
+    "appspot.com", "blogspot.com",
+    "co.id", "co.il", "co.in", "co.jp", "co.kr", "co.nz", "co.th", "co.uk", "co.za",
+    "com.ar", "com.au", "com.br", "com.cn", "com.co", "com.hk", "com.mx", "com.my",
+    "com.pl", "com.sg", "com.tr", "com.tw", "com.ua",
+    "edu.au", "github.io", "gitlab.io", "go.jp",
+    "gov.au", "gov.br", "gov.cn", "gov.in", "gov.uk",
+    "herokuapp.com", "ltd.uk",
+    "ne.jp", "net.au", "net.br", "net.cn", "net.in", "net.nz",
+    "or.jp", "or.kr", "org.au", "org.br", "org.cn", "org.in", "org.nz", "org.uk", "org.za",
+    "plc.uk",
+};
+
+bool ClientCookieJar::is_public_suffix(const std::string& domain)
+{
+    return public_suffix_start(domain) == 0;
+}
+
+std::size_t ClientCookieJar::public_suffix_start(const std::string& host)
+{
+    auto last = host.rfind('.');
+    if ( last == std::string::npos )
+        return 0;
+
+    if ( last > 0 )
+    {
+        auto previous = host.rfind('.', last - 1);
+        std::size_t start = previous == std::string::npos ? 0 : previous + 1;
+        const char* suffix = host.c_str() + start;
+        auto begin = std::begin(multi_label_suffixes);
+        auto end = std::end(multi_label_suffixes);
+        auto found = std::lower_bound(begin, end, suffix, [](const char* a, const char* b) {
+            return std::strcmp(a, b) < 0;
+        });
+        if ( found != end && std::strcmp(*found, suffix) == 0 )
+            return start;
+    }
+
+    return last + 1;
+}
+
+std::string ClientCookieJar::registrable_domain(const std::string& host)
+{
+    // IP addresses are only matched exactly
+    if ( host.find(':') != std::string::npos ||
+         std::all_of(host.begin(), host.end(), [](char c) {
+            return c == '.' || melanolib::string::ascii::is_digit(c);
+         }) )
+        return host;
+
+    std::size_t suffix = public_suffix_start(host);
+    if ( suffix < 2 )
+        return host;
+    auto previous = host.rfind('.', suffix - 2);
+    if ( previous == std::string::npos )
+        return host;
+    return host.substr(previous + 1);
+}
+
+void ClientCookieJar::store(
+    const Uri& uri,
+    const CookieJar& cookies,
+    const melanolib::time::DateTime& now
+)
+{
+    for ( const auto& cookie : cookies )
+        store(uri, cookie.first, cookie.second, now);
+}
+
+bool ClientCookieJar::store(
+    const Uri& uri,
+    const std::string& name,
+    Cookie cookie,
+    const melanolib::time::DateTime& now
+)
+{
+    std::string host = melanolib::string::strtolower(uri.authority.host);
+    if ( host.empty() )
+        return false;
+
+    bool host_only = cookie.domain.empty();
+    if ( host_only )
+    {
+        cookie.domain = host;
+    }
+    else
+    {
+        cookie.domain = melanolib::string::strtolower(cookie.domain);
+        if ( !cookie.matches_domain(host) )
+            return false;
+
+        // A public suffix can only be used by the host itself
+        if ( is_public_suffix(cookie.domain) )
+        {
+            if ( cookie.domain != host )
+                return false;
+            host_only = true;
+        }
+    }
+
+    // Cookies can only be set for a single registrable domain
+    std::string key = registrable_domain(host);
+    if ( registrable_domain(cookie.domain) != key )
+        return false;
+
+    // An empty path can't be told apart from "/", like Cookie::matches_path()
+    // it's considered to match all paths
+    std::string path = cookie.path.string();
+
+    cookie.creation_time = now;
+    bool remove = cookie.expired(now);
+
+    std::unique_lock<std::shared_timed_mutex> lock(mutex);
+    PathIndex& index = domains[key];
+    remove_expired(index, now);
+
+    auto& entries = index[path];
+    auto existing = std::find_if(entries.begin(), entries.end(), [&](const Entry& entry) {
+        return entry.name == name && entry.cookie.domain == cookie.domain;
+    });
+
+    if ( existing != entries.end() )
+    {
+        if ( remove )
+        {
+            entries.erase(existing);
+            count--;
+        }
+        else
+        {
+            // Replaced in place, so it keeps its position in the output
+            *existing = Entry{name, std::move(cookie), host_only};
+        }
+    }
+    else if ( !remove )
+    {
+        entries.push_back(Entry{name, std::move(cookie), host_only});
+        count++;
+    }
+
+    if ( entries.empty() )
+        index.erase(path);
+    if ( index.empty() )
+        domains.erase(key);
+
+    return true;
+}
+
+void ClientCookieJar::select(
+    const Uri& uri,
+    DataMap& output,
+    const melanolib::time::DateTime& now
+) const
+{
+    std::string host = melanolib::string::strtolower(uri.authority.host);
+    bool secure = uri.scheme == "https";
+
+    std::shared_lock<std::shared_timed_mutex> lock(mutex);
+    auto domain = domains.find(registrable_domain(host));
+    if ( domain == domains.end() )
+        return;
+
+    // Path prefixes, from the root to the full path
+    std::vector<std::string> prefixes;
+    prefixes.reserve(uri.path.size() + 1);
+    prefixes.push_back("/");
+    std::string prefix;
+    for ( const auto& segment : uri.path )
+    {
+        prefix += '/' + segment;
+        prefixes.push_back(prefix);
+    }
+
+    for ( auto path = prefixes.rbegin(); path != prefixes.rend(); ++path )
+    {
+        auto entries = domain->second.find(*path);
+        if ( entries == domain->second.end() )
+            continue;
+
+        for ( const auto& entry : entries->second )
+        {
+            if ( entry.host_only ? entry.cookie.domain != host : !entry.cookie.matches_domain(host) )
+                continue;
+            if ( entry.cookie.secure && !secure )
+                continue;
+            if ( entry.cookie.expired(now) || output.contains(entry.name) )
+                continue;
+            output.append(entry.name, entry.cookie.value);
+        }
+    }
+}
+
+void ClientCookieJar::remove_expired(PathIndex& index, const melanolib::time::DateTime& now)
+{
+    for ( auto path = index.begin(); path != index.end(); )
+    {
+        auto& entries = path->second;
+        auto end = std::remove_if(entries.begin(), entries.end(), [&now](const Entry& entry) {
+            return entry.cookie.expired(now);
+        });
+        count -= entries.end() - end;
+        entries.erase(end, entries.end());
+
+        if ( entries.empty() )
+            path = index.erase(path);
+        else
+            ++path;
+    }
+}
+
+void ClientCookieJar::remove_expired(const melanolib::time::DateTime& now)
+{
+    std::unique_lock<std::shared_timed_mutex> lock(mutex);
+    for ( auto domain = domains.begin(); domain != domains.end(); )
+    {
+        remove_expired(domain->second, now);
+        if ( domain->second.empty() )
+            domain = domains.erase(domain);
+        else
+            ++domain;
+    }
+}
+
+void ClientCookieJar::clear()
+{
+    std::unique_lock<std::shared_timed_mutex> lock(mutex);
+    domains.clear();
+    count = 0;
+}
+
+std::size_t ClientCookieJar::size() const
+{
+    std::shared_lock<std::shared_timed_mutex> lock(mutex);
+    return count;
+}
+
+} // namespace httpony
@@ -22,6 +22,12 @@
 #include "httpony/http/parser.hpp"
 #include "httpony/base_encoding.hpp"
 
+/// \cond
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+/// \endcond
+
 namespace httpony {
 
 Status Http1Parser::request(std::istream& stream, Request& request) const
@@ -60,7 +66,7 @@ Status Http1Parser::request(std::istream& stream, Request& request) const
 
     /// \todo Maybe move parsing/formatting out of UserAgent
     if ( request.headers.contains("User-Agent") )
-        request.user_agent = request.headers.get("User-Agent");
+        request.user_agent = UserAgentCache::instance().parse(request.headers.get("User-Agent"));
 
     if ( request.headers.contains("Content-Length") ||
          request.headers.contains("Transfer-Encoding") )
@@ -101,13 +107,11 @@ OperationStatus Http1Parser::response(std::istream& stream, Response& response)
     {
         for ( const auto& cookie_header : response.headers.key_range("Set-Cookie") )
         {
-            melanolib::string::QuickStream cookie_stream(cookie_header.second);
-            DataMap cookie_params;
-            if ( !header_parameters(cookie_stream, cookie_params) || cookie_params.empty() )
+            std::string name;
+            Cookie cookie;
+            if ( !set_cookie(cookie_header.second, name, cookie) )
                 return "malformed headers";
-
-            Cookie cookie(cookie_params.front().second);
-            response.cookies.append(cookie_params.front().first, cookie);
+            response.cookies.append(name, cookie);
         }
     }
 
@@ -409,4 +413,110 @@ bool Http1Parser::auth(const std::string& header_contents, Auth& auth) const
     return true;
 }
 
+/**
+ * \brief Removes leading and trailing spaces
+ */
+static std::string trimmed(const std::string& string, std::size_t begin, std::size_t end)
+{
+    using melanolib::string::ascii::is_space;
+    while ( begin < end && is_space(string[begin]) )
+        begin++;
+    while ( end > begin && is_space(string[end - 1]) )
+        end--;
+    return string.substr(begin, end - begin);
+}
+
+/**
+ * \brief Parses a cookie date like "Wed, 21 Oct 2015 07:28:00 GMT"
+ */
+static melanolib::Optional<melanolib::time::DateTime> cookie_date(const std::string& string)
+{
+    std::tm time = {};
+    std::istringstream stream(string);
+    stream.imbue(std::locale::classic());
+    stream >> std::get_time(&time, "%a, %d %b %Y %H:%M:%S");
+    if ( stream.fail() )
+        return {};
+
+    using melanolib::time::DateTime;
+    return DateTime(DateTime::Time(std::chrono::duration_cast<DateTime::Time::duration>(
+        std::chrono::seconds(timegm(&time))
+    )));
+}
+
+bool Http1Parser::set_cookie(const std::string& header_value, std::string& name, Cookie& cookie) const
+{
+    std::size_t end = header_value.find(';');
+    if ( end == std::string::npos )
+        end = header_value.size();
+
+    std::size_t equals = header_value.find('=');
+    if ( equals == std::string::npos || equals > end )
+        return false;
+
+    name = trimmed(header_value, 0, equals);
+    if ( name.empty() )
+        return false;
+
+    cookie = Cookie(trimmed(header_value, equals + 1, end));
+
+    while ( end < header_value.size() )
+    {
+        std::size_t begin = end + 1;
+        end = header_value.find(';', begin);
+        if ( end == std::string::npos )
+            end = header_value.size();
+
+        std::string attribute = trimmed(header_value, begin, end);
+        std::string value;
+        std::size_t attr_equals = attribute.find('=');
+        if ( attr_equals != std::string::npos )
+        {
+            value = trimmed(attribute, attr_equals + 1, attribute.size());
+            attribute = trimmed(attribute, 0, attr_equals);
+        }
+        attribute = melanolib::string::strtolower(attribute);
+
+        if ( attribute == "expires" )
+        {
+            if ( auto date = cookie_date(value) )
+                cookie.expires = *date;
+        }
+        else if ( attribute == "max-age" )
+        {
+            if ( !value.empty() && (melanolib::string::ascii::is_digit(value[0]) || value[0] == '-') )
+            {
+                try {
+                    cookie.max_age = melanolib::time::seconds(std::stol(value));
+                } catch ( const std::exception& ) {}
+            }
+        }
+        else if ( attribute == "domain" )
+        {
+            if ( !value.empty() && value[0] == '.' )
+                value.erase(0, 1);
+            cookie.domain = melanolib::string::strtolower(value);
+        }
+        else if ( attribute == "path" )
+        {
+            if ( !value.empty() && value[0] == '/' )
+                cookie.path = Path(value);
+        }
+        else if ( attribute == "secure" )
+        {
+            cookie.secure = true;
+        }
+        else if ( attribute == "httponly" )
+        {
+            cookie.http_only = true;
+        }
+        else if ( !attribute.empty() )
+        {
+            cookie.extension.push_back(trimmed(header_value, begin, end));
+        }
+    }
+
+    return true;
+}
+
 } // namespace httpony
@@ -30,6 +30,20 @@ std::size_t NetworkInputBuffer::read_some(std::size_t size, OperationStatus& sta
         return size;
     size -= prev_size;
 
+    if ( _account )
+    {
+        if ( _account->shed() )
+        {
+            status = "connection dropped to reduce memory usage";
+            return prev_size;
+        }
+        if ( !_account->update(MemoryAccount::Input, prev_size + size) )
+        {
+            status = "memory budget exceeded";
+            return prev_size;
+        }
+    }
+
     auto in_buffer = prepare(size);
 
     auto read_size = _socket.read_some(in_buffer, status);
@@ -38,6 +52,9 @@ std::size_t NetworkInputBuffer::read_some(std::size_t size, OperationStatus& sta
 
     commit(read_size);
 
+    if ( _account )
+        _account->set(MemoryAccount::Input, this->size());
+
     return read_size + prev_size;
 }
 
@@ -54,6 +71,9 @@ void NetworkInputBuffer::expect_input(std::size_t byte_count)
 NetworkInputBuffer::int_type NetworkInputBuffer::underflow()
 {
     int_type ret = boost::asio::streambuf::underflow();
+    if ( ret == traits_type::eof() && _account )
+        _account->set(MemoryAccount::Input, 0);
+
     if ( ret == traits_type::eof() && _expected_input > 0 )
     {
         auto request_size = _expected_input > chunk_size() ?
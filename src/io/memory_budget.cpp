@@ -0,0 +1,279 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "httpony/io/memory_budget.hpp"
+
+/// \cond
+#include <algorithm>
+/// \endcond
+
+namespace httpony {
+namespace io {
+
+void MemoryAccount::attach(MemoryBudget* budget)
+{
+    if ( budget == _budget )
+        return;
+
+    std::size_t total = used();
+    if ( _budget )
+    {
+        _budget->remove_account(this);
+        _budget->release(total);
+    }
+
+    _budget = budget;
+    _shed = false;
+
+    if ( _budget )
+    {
+        _budget->add_account(this);
+        _budget->force_acquire(total);
+    }
+}
+
+bool MemoryAccount::update(Usage usage, std::size_t size)
+{
+    std::size_t old_size = _usage[usage];
+    if ( size > old_size && _budget && !_budget->acquire(*this, size - old_size) )
+        return false;
+    if ( size < old_size && _budget )
+        _budget->release(old_size - size);
+    change(usage, size);
+    return true;
+}
+
+void MemoryAccount::set(Usage usage, std::size_t size)
+{
+    std::size_t old_size = _usage[usage];
+    if ( _budget )
+    {
+        if ( size > old_size )
+            _budget->force_acquire(size - old_size);
+        else if ( size < old_size )
+            _budget->release(old_size - size);
+    }
+    change(usage, size);
+}
+
+void MemoryAccount::change(Usage usage, std::size_t size)
+{
+    std::size_t old_size = _usage[usage];
+    _usage[usage] = size;
+    if ( size > old_size )
+        _total.fetch_add(size - old_size, std::memory_order_relaxed);
+    else
+        _total.fetch_sub(old_size - size, std::memory_order_relaxed);
+}
+
+MemoryBudget::~MemoryBudget()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for ( auto account : accounts )
+        account->_budget = nullptr;
+}
+
+void MemoryBudget::set_limit(std::size_t limit)
+{
+    _limit = limit;
+    if ( _waiting )
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        released.notify_all();
+    }
+}
+
+MemoryBudget::Stats MemoryBudget::stats() const
+{
+    Stats stats;
+    stats.used = used();
+    stats.peak = _peak;
+    stats.limit = _limit;
+    stats.denied = _denied;
+    stats.shed = _shed;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.connections = accounts.size();
+    for ( auto account : accounts )
+        stats.largest = std::max(stats.largest, account->used());
+    return stats;
+}
+
+bool MemoryBudget::try_acquire(std::size_t bytes)
+{
+    std::size_t limit = _limit;
+    std::size_t used = _used.load();
+    do
+    {
+        if ( bytes > limit || used > limit - bytes )
+            return false;
+    }
+    while ( !_used.compare_exchange_weak(used, used + bytes, std::memory_order_relaxed) );
+    update_peak(used + bytes);
+    return true;
+}
+
+void MemoryBudget::force_acquire(std::size_t bytes)
+{
+    update_peak(_used.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+}
+
+void MemoryBudget::release(std::size_t bytes)
+{
+    _used.fetch_sub(bytes);
+    if ( _waiting )
+    {
+        // Locking ensures waiters are either before their check or waiting
+        std::lock_guard<std::mutex> lock(mutex);
+        released.notify_all();
+    }
+}
+
+void MemoryBudget::update_peak(std::size_t used)
+{
+    std::size_t peak = _peak.load(std::memory_order_relaxed);
+    while ( used > peak && !_peak.compare_exchange_weak(peak, used, std::memory_order_relaxed) )
+    {}
+}
+
+bool MemoryBudget::acquire(MemoryAccount& account, std::size_t bytes)
+{
+    if ( try_acquire(bytes) )
+        return true;
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // Marked connections keep their memory until they are dropped,
+    // so even with Shed the requester has to wait for it
+    bool can_wait = !account.shed() && account.can_wait();
+    if ( _policy == Policy::Shed && !account.shed() && !shed_others(account, bytes) )
+        can_wait = false;
+
+    if ( !can_wait )
+    {
+        _denied++;
+        return false;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + _backpressure_timeout.load();
+    _waiting++;
+    bool acquired = false;
+    while ( !(acquired = try_acquire(bytes)) )
+    {
+        // Nobody else can make room, waiting would only stall this thread
+        if ( !others_can_release(account, bytes) )
+            break;
+
+        if ( released.wait_until(lock, deadline) == std::cv_status::timeout )
+        {
+            acquired = try_acquire(bytes);
+            break;
+        }
+    }
+    _waiting--;
+
+    if ( !acquired )
+        _denied++;
+    return acquired;
+}
+
+std::size_t MemoryBudget::shortfall(std::size_t bytes) const
+{
+    std::size_t limit = _limit;
+    std::size_t needed = _used.load() + bytes;
+    if ( needed < bytes || bytes > limit )
+        return unlimited();
+    return needed > limit ? needed - limit : 0;
+}
+
+bool MemoryBudget::shed_others(const MemoryAccount& account, std::size_t bytes)
+{
+    std::size_t needed = shortfall(bytes);
+    if ( needed == unlimited() )
+        return false;
+
+    // Memory held by connections already marked is on its way out
+    std::size_t promised = 0;
+    for ( auto other : accounts )
+    {
+        if ( other != &account && other->shed() )
+            promised += other->used();
+    }
+
+    while ( promised < needed )
+    {
+        MemoryAccount* largest = nullptr;
+        std::size_t largest_size = account.used() + bytes;
+        for ( auto other : accounts )
+        {
+            if ( other != &account && !other->shed() && other->used() > largest_size )
+            {
+                largest = other;
+                largest_size = other->used();
+            }
+        }
+
+        if ( !largest )
+            return false;
+
+        largest->_shed = true;
+        _shed++;
+        promised += largest_size;
+    }
+
+    return true;
+}
+
+bool MemoryBudget::others_can_release(const MemoryAccount& account, std::size_t bytes) const
+{
+    std::size_t needed = shortfall(bytes);
+    if ( needed == unlimited() )
+        return false;
+
+    std::size_t own = account.used();
+    std::size_t releasable = 0;
+    std::size_t largest = 0;
+    for ( auto other : accounts )
+    {
+        if ( other != &account )
+        {
+            releasable += other->used();
+            largest = std::max(largest, other->used());
+        }
+    }
+
+    return largest > own && releasable >= needed;
+}
+
+void MemoryBudget::add_account(MemoryAccount* account)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    accounts.insert(account);
+}
+
+void MemoryBudget::remove_account(MemoryAccount* account)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    accounts.erase(account);
+}
+
+} // namespace io
+} // namespace httpony
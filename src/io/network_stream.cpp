@@ -113,12 +113,15 @@ std::string InputContentStream::read_all(bool preserve_input)
 void OutputContentStream::copy_from(OutputContentStream& other)
 {
     other.flush();
-    for ( const auto& buf : other.buffer.data() )
+    const char* stored = boost::asio::buffer_cast<const char*>(other.buffer.data());
+    std::size_t position = 0;
+    for ( const auto& reference : other.references )
     {
-        auto data = boost::asio::buffer_cast<const char*>(buf);
-        auto size = boost::asio::buffer_size(buf);
-        write(data, size);
+        write(stored + position, reference.offset - position);
+        position = reference.offset;
+        write_reference(reference.data, reference.size);
     }
+    write(stored + position, other.buffer.size() - position);
 }
 
 } // namespace io
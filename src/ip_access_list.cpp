@@ -0,0 +1,139 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "httpony/ip_access_list.hpp"
+
+/// \cond
+#include <mutex>
+/// \endcond
+
+namespace httpony {
+
+IPAccessList::IPAccessList(Rule default_rule)
+    : nodes(1), _default_rule(default_rule)
+{}
+
+bool IPAccessList::add(const std::string& range, Rule rule)
+{
+    auto slash = range.find('/');
+    BinaryIPAddress address(range.data(), range.data() + std::min(slash, range.size()));
+    if ( !address.valid() )
+        return false;
+
+    unsigned prefix_length = address.type == IPAddress::Type::IPv4 ? 32 : 128;
+    if ( slash != std::string::npos )
+    {
+        if ( slash + 1 == range.size() || range.size() - slash > 4 )
+            return false;
+        prefix_length = 0;
+        for ( auto it = range.begin() + slash + 1; it != range.end(); ++it )
+        {
+            if ( *it < '0' || *it > '9' )
+                return false;
+            prefix_length = prefix_length * 10 + (*it - '0');
+        }
+    }
+
+    return add(address, prefix_length, rule);
+}
+
+bool IPAccessList::add(const BinaryIPAddress& address, unsigned prefix_length, Rule rule)
+{
+    if ( !address.valid() )
+        return false;
+
+    if ( address.type == IPAddress::Type::IPv4 )
+    {
+        if ( prefix_length > 32 )
+            return false;
+        // Skip the ::ffff: part of the mapped address
+        prefix_length += 96;
+    }
+    else if ( prefix_length > 128 )
+    {
+        return false;
+    }
+
+    std::unique_lock<std::shared_timed_mutex> lock(mutex);
+    uint32_t node = 0;
+    for ( unsigned i = 0; i < prefix_length; i++ )
+    {
+        bool bit = address.bit(i);
+        uint32_t child = nodes[node].children[bit];
+        if ( !child )
+        {
+            child = nodes.size();
+            nodes.emplace_back();
+            nodes[node].children[bit] = child;
+        }
+        node = child;
+    }
+    nodes[node].has_rule = true;
+    nodes[node].rule = rule;
+    return true;
+}
+
+IPAccessList::Rule IPAccessList::check(const BinaryIPAddress& address) const
+{
+    std::shared_lock<std::shared_timed_mutex> lock(mutex);
+
+    if ( !address.valid() )
+        return _default_rule;
+
+    const Node* node = &nodes[0];
+    Rule result = node->has_rule ? node->rule : _default_rule;
+    for ( std::size_t i = 0; i < 128; i++ )
+    {
+        uint32_t child = node->children[address.bit(i)];
+        if ( !child )
+            break;
+        node = &nodes[child];
+        if ( node->has_rule )
+            result = node->rule;
+    }
+    return result;
+}
+
+IPAccessList::Rule IPAccessList::default_rule() const
+{
+    std::shared_lock<std::shared_timed_mutex> lock(mutex);
+    return _default_rule;
+}
+
+void IPAccessList::set_default_rule(Rule rule)
+{
+    std::unique_lock<std::shared_timed_mutex> lock(mutex);
+    _default_rule = rule;
+}
+
+void IPAccessList::clear()
+{
+    std::unique_lock<std::shared_timed_mutex> lock(mutex);
+    nodes.assign(1, Node());
+}
+
+bool IPAccessList::empty() const
+{
+    std::shared_lock<std::shared_timed_mutex> lock(mutex);
+    return nodes.size() == 1 && !nodes[0].has_rule;
+}
+
+} // namespace httpony
@@ -0,0 +1,302 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "httpony/ip_address.hpp"
+
+/// \cond
+#include <cstring>
+/// \endcond
+
+namespace httpony {
+
+static int hex_value(char c)
+{
+    if ( c >= '0' && c <= '9' )
+        return c - '0';
+    if ( c >= 'a' && c <= 'f' )
+        return c - 'a' + 10;
+    if ( c >= 'A' && c <= 'F' )
+        return c - 'A' + 10;
+    return -1;
+}
+
+/**
+ * \brief Parses a dotted quad into 4 bytes
+ */
+static bool parse_ipv4(const char* begin, const char* end, uint8_t* output)
+{
+    for ( int part = 0; part < 4; part++ )
+    {
+        if ( part > 0 )
+        {
+            if ( begin == end || *begin != '.' )
+                return false;
+            ++begin;
+        }
+
+        unsigned value = 0;
+        int digits = 0;
+        for ( ; begin != end && *begin >= '0' && *begin <= '9'; ++begin )
+        {
+            if ( ++digits > 3 )
+                return false;
+            value = value * 10 + (*begin - '0');
+        }
+        if ( digits == 0 || value > 255 )
+            return false;
+        output[part] = value;
+    }
+    return begin == end;
+}
+
+/**
+ * \brief Parses an IPv6 address into 16 bytes
+ *
+ * Supports :: compression and a trailing dotted quad
+ */
+static bool parse_ipv6(const char* begin, const char* end, uint8_t* output)
+{
+    uint8_t parsed[16] = {};
+    int size = 0;
+    int gap = -1;
+
+    if ( end - begin >= 2 && begin[0] == ':' && begin[1] == ':' )
+    {
+        gap = 0;
+        begin += 2;
+    }
+    else if ( begin != end && *begin == ':' )
+    {
+        return false;
+    }
+
+    while ( begin != end )
+    {
+        const char* group = begin;
+        unsigned value = 0;
+        int digits = 0;
+        for ( ; begin != end && hex_value(*begin) >= 0; ++begin )
+        {
+            if ( ++digits > 4 )
+                return false;
+            value = value * 16 + hex_value(*begin);
+        }
+
+        if ( begin != end && *begin == '.' )
+        {
+            if ( size > 12 || !parse_ipv4(group, end, parsed + size) )
+                return false;
+            size += 4;
+            break;
+        }
+
+        if ( digits == 0 || size > 14 )
+            return false;
+        parsed[size++] = value >> 8;
+        parsed[size++] = value & 0xff;
+
+        if ( begin == end )
+            break;
+        if ( *begin != ':' || ++begin == end )
+            return false;
+        if ( *begin == ':' )
+        {
+            if ( gap != -1 )
+                return false;
+            gap = size;
+            ++begin;
+        }
+    }
+
+    if ( gap == -1 )
+    {
+        if ( size != 16 )
+            return false;
+        std::memcpy(output, parsed, 16);
+        return true;
+    }
+
+    if ( size == 16 )
+        return false;
+
+    std::memset(output, 0, 16);
+    std::memcpy(output, parsed, gap);
+    std::memcpy(output + 16 - (size - gap), parsed + gap, size - gap);
+    return true;
+}
+
+BinaryIPAddress::BinaryIPAddress(const char* begin, const char* end, uint16_t port)
+    : port(port)
+{
+    if ( parse_ipv4(begin, end, bytes.data() + 12) )
+    {
+        bytes[10] = bytes[11] = 0xff;
+        type = IPAddress::Type::IPv4;
+    }
+    else if ( parse_ipv6(begin, end, bytes.data()) )
+    {
+        type = IPAddress::Type::IPv6;
+    }
+    else
+    {
+        bytes.fill(0);
+    }
+}
+
+std::string BinaryIPAddress::address_string() const
+{
+    static const char digits[] = "0123456789abcdef";
+
+    if ( !valid() )
+        return {};
+
+    std::string output;
+    output.reserve(39);
+
+    auto write_ipv4 = [this, &output]() {
+        for ( int i = 12; i < 16; i++ )
+        {
+            if ( i > 12 )
+                output += '.';
+            output += std::to_string(bytes[i]);
+        }
+    };
+
+    if ( type == IPAddress::Type::IPv4 )
+    {
+        write_ipv4();
+        return output;
+    }
+
+    uint16_t groups[8];
+    for ( int i = 0; i < 8; i++ )
+        groups[i] = (bytes[i * 2] << 8) | bytes[i * 2 + 1];
+
+    // Longest run of at least two zero groups is replaced by ::
+    int best_start = -1;
+    int best_size = 1;
+    for ( int i = 0; i < 8; )
+    {
+        if ( groups[i] != 0 )
+        {
+            i++;
+            continue;
+        }
+        int start = i;
+        while ( i < 8 && groups[i] == 0 )
+            i++;
+        if ( i - start > best_size )
+        {
+            best_start = start;
+            best_size = i - start;
+        }
+    }
+
+    int last_group = is_ipv4_mapped() ? 6 : 8;
+    for ( int i = 0; i < last_group; i++ )
+    {
+        if ( i == best_start )
+        {
+            output += "::";
+            i += best_size - 1;
+            continue;
+        }
+        if ( !output.empty() && output.back() != ':' )
+            output += ':';
+
+        bool leading = true;
+        for ( int shift = 12; shift >= 0; shift -= 4 )
+        {
+            int digit = (groups[i] >> shift) & 0xf;
+            if ( digit == 0 && leading && shift != 0 )
+                continue;
+            leading = false;
+            output += digits[digit];
+        }
+    }
+
+    if ( last_group == 6 )
+    {
+        if ( output.back() != ':' )
+            output += ':';
+        write_ipv4();
+    }
+
+    return output;
+}
+
+IPAddress::IPAddress(const std::string& address, Type default_type)
+{
+    const char* begin = address.data();
+    const char* end = begin + address.size();
+    const char* host_end = end;
+    const char* port_begin = end;
+
+    if ( begin != end && *begin == '[' )
+    {
+        ++begin;
+        host_end = std::find(begin, end, ']');
+        port_begin = host_end == end ? end : host_end + 1;
+        if ( port_begin != end && *port_begin != ':' )
+            return;
+    }
+    else
+    {
+        const char* colon = std::find(begin, end, ':');
+        // More than one colon means an IPv6 address without port
+        if ( colon != end && std::find(colon + 1, end, ':') == end )
+        {
+            host_end = colon;
+            port_begin = colon;
+        }
+    }
+
+    uint16_t parsed_port = 0;
+    if ( port_begin != end )
+    {
+        unsigned value = 0;
+        if ( ++port_begin == end )
+            return;
+        for ( ; port_begin != end; ++port_begin )
+        {
+            if ( *port_begin < '0' || *port_begin > '9' )
+                return;
+            value = value * 10 + (*port_begin - '0');
+            if ( value > 0xffff )
+                return;
+        }
+        parsed_port = value;
+    }
+
+    BinaryIPAddress binary(begin, host_end);
+    if ( binary.valid() )
+    {
+        type = binary.type;
+        string.assign(begin, host_end);
+    }
+    else
+    {
+        type = default_type;
+    }
+    port = parsed_port;
+}
+
+} // namespace httpony
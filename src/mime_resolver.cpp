@@ -0,0 +1,168 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "httpony/mime_resolver.hpp"
+
+/// \cond
+#include <fstream>
+#include <sstream>
+
+#include <sys/stat.h>
+/// \endcond
+
+namespace httpony {
+
+MimeResolver::MimeResolver(Sniffer sniffer, MimeType fallback)
+    : _sniffer(std::move(sniffer)),
+      _fallback(std::move(fallback))
+{
+    const char* const defaults[][2] = {
+        {"css",   "text/css"},
+        {"csv",   "text/csv"},
+        {"gif",   "image/gif"},
+        {"gz",    "application/gzip"},
+        {"htm",   "text/html"},
+        {"html",  "text/html"},
+        {"ico",   "image/x-icon"},
+        {"jpeg",  "image/jpeg"},
+        {"jpg",   "image/jpeg"},
+        {"js",    "application/javascript"},
+        {"json",  "application/json"},
+        {"mp3",   "audio/mpeg"},
+        {"mp4",   "video/mp4"},
+        {"ogg",   "audio/ogg"},
+        {"pdf",   "application/pdf"},
+        {"png",   "image/png"},
+        {"svg",   "image/svg+xml"},
+        {"txt",   "text/plain"},
+        {"wav",   "audio/wav"},
+        {"webm",  "video/webm"},
+        {"webp",  "image/webp"},
+        {"woff",  "font/woff"},
+        {"woff2", "font/woff2"},
+        {"xhtml", "application/xhtml+xml"},
+        {"xml",   "application/xml"},
+        {"zip",   "application/zip"},
+    };
+
+    for ( const auto& item : defaults )
+        _extensions.emplace(item[0], MimeType(item[1]));
+}
+
+bool MimeResolver::load_mime_types(const std::string& filename)
+{
+    std::ifstream input(filename);
+    if ( !input )
+        return false;
+    load_mime_types(input);
+    return true;
+}
+
+void MimeResolver::load_mime_types(std::istream& input)
+{
+    std::string line;
+    while ( std::getline(input, line) )
+    {
+        auto comment = line.find('#');
+        if ( comment != std::string::npos )
+            line.erase(comment);
+
+        std::istringstream words(line);
+        std::string type;
+        if ( !(words >> type) )
+            continue;
+
+        MimeType mime(type);
+        if ( !mime.valid() )
+            continue;
+
+        std::string extension;
+        while ( words >> extension )
+            add_extension(extension, mime);
+    }
+}
+
+void MimeResolver::add_extension(const std::string& extension, const MimeType& type)
+{
+    _extensions[melanolib::string::strtolower(extension)] = type;
+}
+
+MimeType MimeResolver::from_extension(const std::string& filename) const
+{
+    auto dot = filename.rfind('.');
+    auto slash = filename.rfind('/');
+    if ( dot == std::string::npos || (slash != std::string::npos && dot < slash) )
+        return {};
+
+    auto iter = _extensions.find(melanolib::string::strtolower(filename.substr(dot + 1)));
+    if ( iter == _extensions.end() )
+        return {};
+    return iter->second;
+}
+
+MimeType MimeResolver::resolve(const std::string& filename)
+{
+    MimeType type = from_extension(filename);
+    if ( type.valid() )
+        return type;
+    if ( !_sniffer )
+        return _fallback;
+
+    struct stat info;
+    if ( stat(filename.c_str(), &info) != 0 )
+        return _fallback;
+
+    FileId id{info.st_dev, info.st_ino};
+    // Files rewritten within the same second still differ in nanoseconds or size
+    CacheEntry entry{info.st_size, info.st_mtim.tv_sec, info.st_mtim.tv_nsec, {}};
+    {
+        std::lock_guard<std::mutex> lock(_cache_mutex);
+        const CacheEntry* cached = _cache.find(id);
+        if ( cached && cached->size == entry.size &&
+             cached->modified_seconds == entry.modified_seconds &&
+             cached->modified_nanoseconds == entry.modified_nanoseconds )
+            return cached->type;
+    }
+
+    type = _sniffer(filename);
+    if ( !type.valid() )
+        type = _fallback;
+
+    entry.type = type;
+    std::lock_guard<std::mutex> lock(_cache_mutex);
+    _cache.insert(id, std::move(entry));
+    return type;
+}
+
+void MimeResolver::set_cache_size(std::size_t size)
+{
+    std::lock_guard<std::mutex> lock(_cache_mutex);
+    _cache.set_capacity(size);
+}
+
+void MimeResolver::clear_cache()
+{
+    std::lock_guard<std::mutex> lock(_cache_mutex);
+    _cache.clear();
+}
+
+} // namespace httpony
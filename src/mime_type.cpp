@@ -24,17 +24,160 @@
 #include "httpony/http/parser.hpp"
 
 
+/// \cond
+#include <algorithm>
+#include <vector>
+/// \endcond
+
 namespace httpony {
+namespace detail {
 
+/**
+ * \brief Case-insensitive comparison of a string with a character range
+ * \returns A value less than, equal to or greater than zero
+ */
+static int compare_icase(const std::string& string, const char* data, std::size_t size)
+{
+    std::size_t common = std::min(string.size(), size);
+    for ( std::size_t i = 0; i < common; i++ )
+    {
+        char c = data[i] >= 'A' && data[i] <= 'Z' ? data[i] - 'A' + 'a' : data[i];
+        if ( string[i] != c )
+            return string[i] < c ? -1 : 1;
+    }
+    if ( string.size() == size )
+        return 0;
+    return string.size() < size ? -1 : 1;
+}
+
+/**
+ * \brief Table of common types, sorted by type and subtype
+ */
+static const std::vector<MediaType>& media_type_table()
+{
+    static const std::vector<MediaType> table = []{
+        const char* const names[][2] = {
+            {"", ""},
+            {"application", "gzip"},
+            {"application", "javascript"},
+            {"application", "json"},
+            {"application", "octet-stream"},
+            {"application", "pdf"},
+            {"application", "x-www-form-urlencoded"},
+            {"application", "xhtml+xml"},
+            {"application", "xml"},
+            {"application", "zip"},
+            {"audio", "mpeg"},
+            {"audio", "ogg"},
+            {"audio", "wav"},
+            {"font", "woff"},
+            {"font", "woff2"},
+            {"image", "gif"},
+            {"image", "jpeg"},
+            {"image", "png"},
+            {"image", "svg+xml"},
+            {"image", "webp"},
+            {"image", "x-icon"},
+            {"message", "http"},
+            {"multipart", "byteranges"},
+            {"multipart", "form-data"},
+            {"text", "css"},
+            {"text", "csv"},
+            {"text", "html"},
+            {"text", "javascript"},
+            {"text", "plain"},
+            {"text", "xml"},
+            {"video", "mp4"},
+            {"video", "webm"},
+        };
+
+        std::vector<MediaType> table;
+        table.reserve(sizeof(names) / sizeof(names[0]));
+        for ( const auto& name : names )
+            table.push_back(MediaType{name[0], name[1], std::string(name[0]) + '/' + name[1], true});
+        return table;
+    }();
+    return table;
+}
+
+const MediaType* find_media_type(
+    const char* type, std::size_t type_size,
+    const char* subtype, std::size_t subtype_size
+)
+{
+    const auto& table = media_type_table();
+    auto iter = std::lower_bound(table.begin(), table.end(), 0,
+        [=](const MediaType& media, int) {
+            int cmp = compare_icase(media.type, type, type_size);
+            if ( cmp == 0 )
+                cmp = compare_icase(media.subtype, subtype, subtype_size);
+            return cmp < 0;
+        }
+    );
+
+    if ( iter != table.end() &&
+         compare_icase(iter->type, type, type_size) == 0 &&
+         compare_icase(iter->subtype, subtype, subtype_size) == 0 )
+        return &*iter;
+
+    return nullptr;
+}
+
+/**
+ * \brief Wraps an interned type, which is never deallocated, without
+ * allocating a control block
+ */
+static std::shared_ptr<const MediaType> shared_media_type(const MediaType* media)
+{
+    return std::shared_ptr<const MediaType>(std::shared_ptr<const MediaType>(), media);
+}
+
+/**
+ * \brief Finds or creates the media type for the given character ranges
+ */
+static std::shared_ptr<const MediaType> media_type(
+    const char* type, std::size_t type_size,
+    const char* subtype, std::size_t subtype_size
+)
+{
+    if ( auto media = find_media_type(type, type_size, subtype, subtype_size) )
+        return shared_media_type(media);
+
+    auto media = std::make_shared<MediaType>();
+    media->type = melanolib::string::strtolower(std::string(type, type_size));
+    media->subtype = melanolib::string::strtolower(std::string(subtype, subtype_size));
+    media->name = media->type + '/' + media->subtype;
+    return media;
+}
+
+std::shared_ptr<const MediaType> media_type(const std::string& type, const std::string& subtype)
+{
+    return media_type(type.data(), type.size(), subtype.data(), subtype.size());
+}
+
+} // namespace detail
 
 MimeType::MimeType(const std::string& string)
 {
-    melanolib::string::QuickStream stream(string);
-    set_type(stream.get_line('/'));
-    set_subtype(stream.get_until(
-        [](char c){ return melanolib::string::ascii::is_space(c) || c ==';'; }
-    ));
+    std::size_t slash = string.find('/');
+    std::size_t type_end = slash == std::string::npos ? string.size() : slash;
+    std::size_t subtype_start = slash == std::string::npos ? string.size() : slash + 1;
+    std::size_t subtype_end = subtype_start;
+    while ( subtype_end < string.size() &&
+            !melanolib::string::ascii::is_space(string[subtype_end]) &&
+            string[subtype_end] != ';' )
+        subtype_end++;
+
+    _media = detail::media_type(
+        string.data(), type_end,
+        string.data() + subtype_start, subtype_end - subtype_start
+    );
+
+    // Most types have no parameters, this avoids running the parser for them
+    if ( subtype_end == string.size() )
+        return;
 
+    melanolib::string::QuickStream stream(string.substr(subtype_end));
     Headers parameters;
     Http1Parser().header_parameters(stream, parameters);
     if ( !parameters.empty() )
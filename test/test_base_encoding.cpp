@@ -23,7 +23,12 @@
 #define BOOST_TEST_MODULE HttPony_BaseEncoding
 #include <boost/test/unit_test.hpp>
 
+#include <cctype>
+#include <sstream>
+#include <vector>
+
 #include "httpony/base_encoding.hpp"
+#include "httpony/base_encoding_stream.hpp"
 
 using namespace httpony;
 
@@ -90,6 +95,226 @@ BOOST_AUTO_TEST_CASE( test_base64_decode_error )
     BOOST_CHECK_THROW( Base64().decode("eA======"), EncodingError );
 }
 
+/**
+ * \brief Straightforward base 64 encoder, used as reference
+ */
+std::string reference_base64(const std::string& input, const char* alphabet)
+{
+    std::string output;
+    uint32_t bits = 0;
+    int count = 0;
+    for ( unsigned char c : input )
+    {
+        bits = (bits << 8) | c;
+        count += 8;
+        while ( count >= 6 )
+        {
+            count -= 6;
+            output += alphabet[(bits >> count) & 0x3f];
+        }
+    }
+    if ( count )
+        output += alphabet[(bits << (6 - count)) & 0x3f];
+    while ( output.size() % 4 )
+        output += '=';
+    return output;
+}
+
+BOOST_AUTO_TEST_CASE( test_base64_blocks )
+{
+    const char* standard = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const char* url = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+    std::string input;
+    uint32_t seed = 1;
+    for ( int size = 0; size < 200; size++ )
+    {
+        input.resize(size);
+        for ( auto& c : input )
+        {
+            seed = seed * 1103515245 + 12345;
+            c = char(seed >> 16);
+        }
+
+        std::string expected = reference_base64(input, standard);
+        BOOST_CHECK_EQUAL( Base64().encode(input), expected );
+        BOOST_CHECK_EQUAL( Base64().decode(expected), input );
+
+        std::string expected_url = reference_base64(input, url);
+        BOOST_CHECK_EQUAL( Base64Url(true).encode(input), expected_url );
+        BOOST_CHECK_EQUAL( Base64Url().decode(expected_url), input );
+        std::string unpadded = expected_url.substr(0, expected_url.find('='));
+        BOOST_CHECK_EQUAL( Base64Url().encode(input), unpadded );
+        BOOST_CHECK_EQUAL( Base64Url().decode(unpadded), input );
+
+        // Output iterator overloads go through intermediate buffers
+        std::vector<byte> encoded;
+        Base64().encode(
+            byte_view(reinterpret_cast<const byte*>(input.data()), input.size()),
+            std::back_inserter(encoded)
+        );
+        BOOST_CHECK( std::string(encoded.begin(), encoded.end()) == expected );
+        std::vector<byte> decoded;
+        BOOST_CHECK( Base64().decode(byte_view(encoded.data(), encoded.size()), std::back_inserter(decoded)) );
+        BOOST_CHECK( std::string(decoded.begin(), decoded.end()) == input );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_base64_blocks_error )
+{
+    std::string valid = Base64().encode(std::string(300, 'x'));
+    for ( std::size_t i = 0; i < valid.size(); i++ )
+    {
+        std::string invalid = valid;
+        invalid[i] = '.';
+        BOOST_CHECK_THROW( Base64().decode(invalid), EncodingError );
+        invalid[i] = char(0xc3);
+        BOOST_CHECK_THROW( Base64().decode(invalid), EncodingError );
+        if ( i < valid.size() - 3 )
+        {
+            invalid[i] = '=';
+            BOOST_CHECK_THROW( Base64().decode(invalid), EncodingError );
+        }
+    }
+}
+
+static_assert(detail::StaticAlphabet<detail::Base16Alphabet>::tables.encode[10] == 'A',
+              "Alphabet tables must be generated at compile time");
+
+BOOST_AUTO_TEST_CASE( test_static_encodings_blocks )
+{
+    std::string input;
+    for ( int i = 0; i < 300; i++ )
+        input += char(i * 31 + 7);
+
+    // Long strings go through the block kernels, compare with short ones
+    std::string base32, base32hex, base16;
+    for ( std::size_t i = 0; i < input.size(); i += 5 )
+    {
+        base32 += Base32().encode(input.substr(i, 5));
+        base32hex += Base32Hex().encode(input.substr(i, 5));
+        base16 += Base16().encode(input.substr(i, 5));
+    }
+    BOOST_CHECK_EQUAL( Base32().encode(input), base32 );
+    BOOST_CHECK_EQUAL( Base32Hex().encode(input), base32hex );
+    BOOST_CHECK_EQUAL( Base16().encode(input), base16 );
+
+    BOOST_CHECK( Base32().decode(base32) == input );
+    BOOST_CHECK( Base32Hex().decode(base32hex) == input );
+    BOOST_CHECK( Base16().decode(base16) == input );
+
+    std::string lower = base32hex;
+    for ( auto& c : lower )
+        c = std::tolower(c);
+    BOOST_CHECK( Base32Hex().decode(lower) == input );
+    for ( auto& c : base16 )
+        c = std::tolower(c);
+    BOOST_CHECK( Base16().decode(base16) == input );
+
+    lower[100] = 'w';
+    BOOST_CHECK_THROW( Base32Hex().decode(lower), EncodingError );
+    base16[100] = 'g';
+    BOOST_CHECK_THROW( Base16().decode(base16), EncodingError );
+    base32[100] = '1';
+    BOOST_CHECK_THROW( Base32().decode(base32), EncodingError );
+}
+
+BOOST_AUTO_TEST_CASE( test_base_encoder_chunks )
+{
+    std::string input;
+    for ( int i = 0; i < 1000; i++ )
+        input += char(i * 7);
+    std::string expected = Base64().encode(input);
+    std::string expected32 = Base32().encode(input);
+
+    for ( std::size_t chunk : {1, 2, 3, 5, 7, 64, 1000} )
+    {
+        BaseEncoder<Base64> encoder;
+        BaseEncoder<Base32> encoder32;
+        std::string output, output32;
+        for ( std::size_t i = 0; i < input.size(); i += chunk )
+        {
+            encoder.feed(input.substr(i, chunk), output);
+            encoder32.feed(input.substr(i, chunk), output32);
+        }
+        encoder.finish(output);
+        encoder32.finish(output32);
+        BOOST_CHECK_EQUAL( output, expected );
+        BOOST_CHECK_EQUAL( output32, expected32 );
+
+        BaseDecoder<Base64> decoder;
+        BaseDecoder<Base32> decoder32;
+        std::string decoded, decoded32;
+        for ( std::size_t i = 0; i < expected.size(); i += chunk )
+            decoder.feed(expected.substr(i, chunk), decoded);
+        for ( std::size_t i = 0; i < expected32.size(); i += chunk )
+            decoder32.feed(expected32.substr(i, chunk), decoded32);
+        decoder.finish(decoded);
+        decoder32.finish(decoded32);
+        BOOST_CHECK( decoded == input );
+        BOOST_CHECK( decoded32 == input );
+    }
+
+    BaseEncoder<Base64Url> url;
+    std::string output;
+    url.feed("x", output);
+    url.finish(output);
+    BOOST_CHECK_EQUAL( output, "eA" );
+}
+
+BOOST_AUTO_TEST_CASE( test_base_decoder_errors )
+{
+    std::string output;
+
+    BaseDecoder<Base64> truncated;
+    truncated.feed("SGVsbG8", output);
+    BOOST_CHECK_THROW( truncated.finish(output), EncodingError );
+
+    BaseDecoder<Base64> after_padding;
+    after_padding.feed("eA==", output);
+    BOOST_CHECK_THROW( after_padding.feed("eA==", output), EncodingError );
+
+    BaseDecoder<Base64> invalid;
+    invalid.feed("SGVs", output);
+    BOOST_CHECK_THROW( invalid.feed("bG.h", output), EncodingError );
+
+    BaseDecoder<Base64> unpadded(Base64(false));
+    output.clear();
+    unpadded.feed("SGVsbG8", output);
+    unpadded.finish(output);
+    BOOST_CHECK_EQUAL( output, "Hello" );
+}
+
+BOOST_AUTO_TEST_CASE( test_base_encoding_streambuf )
+{
+    std::string input;
+    for ( int i = 0; i < 10000; i++ )
+        input += char(i * 13);
+
+    std::ostringstream encoded;
+    {
+        BaseEncoderBuffer<Base64> buffer(encoded.rdbuf());
+        std::ostream stream(&buffer);
+        for ( std::size_t i = 0; i < input.size(); i += 777 )
+            stream << input.substr(i, 777);
+        stream.put('!');
+    }
+    BOOST_CHECK_EQUAL( encoded.str(), Base64().encode(input + '!') );
+
+    std::istringstream source(encoded.str());
+    BaseDecoderBuffer<Base64> buffer(source.rdbuf());
+    std::istream stream(&buffer);
+    std::string decoded{std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()};
+    BOOST_CHECK( decoded == input + '!' );
+
+    std::istringstream bad_source("SGVsbG8h....");
+    BaseDecoderBuffer<Base64> bad_buffer(bad_source.rdbuf());
+    std::istream bad_stream(&bad_buffer);
+    std::string word;
+    bad_stream >> word;
+    BOOST_CHECK( bad_stream.bad() );
+}
+
 BOOST_AUTO_TEST_CASE( test_base32_encode )
 {
     BOOST_CHECK_EQUAL( Base32().encode("Pony!"), "KBXW46JB" );
@@ -0,0 +1,143 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#define BOOST_TEST_MODULE HttPony_Cookie
+#include <boost/test/unit_test.hpp>
+
+#include "httpony/http/cookie_jar.hpp"
+#include "httpony/http/parser.hpp"
+
+using namespace httpony;
+
+BOOST_AUTO_TEST_CASE( test_parse_set_cookie )
+{
+    Http1Parser parser;
+    std::string name;
+    Cookie cookie;
+
+    BOOST_CHECK( parser.set_cookie("id=a3fWa; Max-Age=60; Domain=.Example.com; Path=/docs; Secure; HttpOnly; Foo=bar", name, cookie) );
+    BOOST_CHECK_EQUAL( name, "id" );
+    BOOST_CHECK_EQUAL( cookie.value, "a3fWa" );
+    BOOST_CHECK( cookie.max_age && cookie.max_age->count() == 60 );
+    BOOST_CHECK_EQUAL( cookie.domain, "example.com" );
+    BOOST_CHECK_EQUAL( cookie.path.string(), "/docs" );
+    BOOST_CHECK( cookie.secure );
+    BOOST_CHECK( cookie.http_only );
+    BOOST_CHECK_EQUAL( cookie.extension.size(), 1u );
+
+    BOOST_CHECK( parser.set_cookie("empty=", name, cookie) );
+    BOOST_CHECK_EQUAL( name, "empty" );
+    BOOST_CHECK_EQUAL( cookie.value, "" );
+
+    BOOST_CHECK( !parser.set_cookie("novalue", name, cookie) );
+    BOOST_CHECK( !parser.set_cookie("=value", name, cookie) );
+}
+
+BOOST_AUTO_TEST_CASE( test_jar_select )
+{
+    ClientCookieJar jar;
+    Uri origin("http://www.example.com/docs/index.html");
+
+    BOOST_CHECK( jar.store(origin, "host", Cookie("1", {}, {}, {}, "/docs")) );
+    BOOST_CHECK( jar.store(origin, "domain", Cookie("2", {}, {}, "example.com", "/")) );
+    BOOST_CHECK( jar.store(origin, "secure", Cookie("3", {}, {}, {}, "/", true)) );
+    BOOST_CHECK( !jar.store(origin, "other", Cookie("4", {}, {}, "example.org")) );
+    BOOST_CHECK( !jar.store(origin, "suffix", Cookie("5", {}, {}, "com")) );
+    BOOST_CHECK_EQUAL( jar.size(), 3u );
+
+    DataMap cookies;
+    jar.select(Uri("http://www.example.com/docs/page"), cookies);
+    BOOST_CHECK_EQUAL( cookies.size(), 2u );
+    // Longer paths come first
+    BOOST_CHECK_EQUAL( cookies.front().first, "host" );
+    BOOST_CHECK_EQUAL( cookies.back().first, "domain" );
+
+    cookies.clear();
+    jar.select(Uri("https://www.example.com/docs/page"), cookies);
+    BOOST_CHECK_EQUAL( cookies.size(), 3u );
+
+    cookies.clear();
+    jar.select(Uri("http://api.example.com/docs/page"), cookies);
+    BOOST_CHECK_EQUAL( cookies.size(), 1u );
+    BOOST_CHECK( cookies.contains("domain") );
+
+    cookies.clear();
+    jar.select(Uri("http://www.example.com/other"), cookies);
+    BOOST_CHECK_EQUAL( cookies.size(), 1u );
+
+    cookies.clear();
+    cookies["host"] = "explicit";
+    jar.select(Uri("http://www.example.com/docs/page"), cookies);
+    BOOST_CHECK_EQUAL( cookies["host"], "explicit" );
+}
+
+BOOST_AUTO_TEST_CASE( test_jar_public_suffix )
+{
+    ClientCookieJar jar;
+    Uri origin("http://a.co.uk/");
+
+    BOOST_CHECK( !jar.store(origin, "suffix", Cookie("1", {}, {}, "co.uk")) );
+    BOOST_CHECK( !jar.store(Uri("http://www.example.com/"), "tld", Cookie("1", {}, {}, "com")) );
+    BOOST_CHECK( jar.store(origin, "domain", Cookie("2", {}, {}, "a.co.uk")) );
+    BOOST_CHECK_EQUAL( jar.size(), 1u );
+
+    DataMap cookies;
+    jar.select(Uri("http://b.co.uk/"), cookies);
+    BOOST_CHECK( cookies.empty() );
+
+    jar.select(Uri("http://www.a.co.uk/"), cookies);
+    BOOST_CHECK( cookies.contains("domain") );
+
+    // A host which is itself a public suffix only gets host-only cookies
+    Uri suffix_host("http://github.io/");
+    BOOST_CHECK( jar.store(suffix_host, "host", Cookie("3", {}, {}, "github.io")) );
+    cookies.clear();
+    jar.select(Uri("http://user.github.io/"), cookies);
+    BOOST_CHECK( cookies.empty() );
+    jar.select(suffix_host, cookies);
+    BOOST_CHECK( cookies.contains("host") );
+}
+
+BOOST_AUTO_TEST_CASE( test_jar_expiry )
+{
+    ClientCookieJar jar;
+    Uri origin("http://example.com/");
+    melanolib::time::DateTime now;
+
+    jar.store(origin, "short", Cookie("1", {}, melanolib::time::seconds(10)), now);
+    jar.store(origin, "long", Cookie("2", {}, melanolib::time::seconds(100)), now);
+    jar.store(origin, "session", Cookie("3"), now);
+    BOOST_CHECK_EQUAL( jar.size(), 3u );
+
+    DataMap cookies;
+    jar.select(origin, cookies, now + melanolib::time::seconds(50));
+    BOOST_CHECK_EQUAL( cookies.size(), 2u );
+    BOOST_CHECK( !cookies.contains("short") );
+
+    jar.remove_expired(now + melanolib::time::seconds(50));
+    BOOST_CHECK_EQUAL( jar.size(), 2u );
+
+    // Max-Age=0 removes the cookie
+    jar.store(origin, "long", Cookie("2", {}, melanolib::time::seconds(0)), now);
+    BOOST_CHECK_EQUAL( jar.size(), 1u );
+}
@@ -24,7 +24,7 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/test/output_test_stream.hpp>
 
-#include "httpony/ip_address.hpp"
+#include "httpony/ip_access_list.hpp"
 
 using namespace httpony;
 
@@ -90,3 +90,117 @@ BOOST_AUTO_TEST_CASE( test_from_string )
     BOOST_CHECK( address.string == "::1" );
     BOOST_CHECK( address.port == 0 );
 }
+
+BOOST_AUTO_TEST_CASE( test_from_string_invalid )
+{
+    IPAddress address("localhost:80");
+    BOOST_CHECK( address.type == IPAddress::Type::IPv6 );
+    BOOST_CHECK( address.string == "" );
+    BOOST_CHECK( address.port == 80 );
+
+    address = IPAddress("127.0.0.1:http");
+    BOOST_CHECK( address.type == IPAddress::Type::Invalid );
+
+    address = IPAddress("127.0.0.1:");
+    BOOST_CHECK( address.type == IPAddress::Type::Invalid );
+
+    address = IPAddress("[::1]x");
+    BOOST_CHECK( address.type == IPAddress::Type::Invalid );
+}
+
+BOOST_AUTO_TEST_CASE( test_binary_parse )
+{
+    BinaryIPAddress address("127.0.0.1", 80);
+    BOOST_CHECK( address.type == IPAddress::Type::IPv4 );
+    BOOST_CHECK( address.port == 80 );
+    BOOST_CHECK( address.is_ipv4_mapped() );
+    BinaryIPAddress::Bytes expected{{0,0,0,0, 0,0,0,0, 0,0,0xff,0xff, 127,0,0,1}};
+    BOOST_CHECK( address.bytes == expected );
+
+    address = BinaryIPAddress("2001:db8::ff00:42:8329");
+    BOOST_CHECK( address.type == IPAddress::Type::IPv6 );
+    expected = {{0x20,0x01, 0x0d,0xb8, 0,0, 0,0, 0,0, 0xff,0x00, 0x00,0x42, 0x83,0x29}};
+    BOOST_CHECK( address.bytes == expected );
+    BOOST_CHECK( !address.is_ipv4_mapped() );
+
+    address = BinaryIPAddress("::ffff:10.1.2.3");
+    BOOST_CHECK( address.type == IPAddress::Type::IPv6 );
+    BOOST_CHECK( address.is_ipv4_mapped() );
+    BOOST_CHECK( address.bytes == BinaryIPAddress("10.1.2.3").bytes );
+
+    BOOST_CHECK( BinaryIPAddress("::").valid() );
+    BOOST_CHECK( BinaryIPAddress("1::").valid() );
+    BOOST_CHECK( BinaryIPAddress("1:2:3:4:5:6:7:8").valid() );
+
+    BOOST_CHECK( !BinaryIPAddress("").valid() );
+    BOOST_CHECK( !BinaryIPAddress("256.0.0.1").valid() );
+    BOOST_CHECK( !BinaryIPAddress("1.2.3").valid() );
+    BOOST_CHECK( !BinaryIPAddress("1.2.3.4.5").valid() );
+    BOOST_CHECK( !BinaryIPAddress("1::2::3").valid() );
+    BOOST_CHECK( !BinaryIPAddress(":1").valid() );
+    BOOST_CHECK( !BinaryIPAddress("1:").valid() );
+    BOOST_CHECK( !BinaryIPAddress("12345::").valid() );
+    BOOST_CHECK( !BinaryIPAddress("1:2:3:4:5:6:7:8:9").valid() );
+    BOOST_CHECK( !BinaryIPAddress("1:2:3:4::5:6:7:8").valid() );
+    BOOST_CHECK( !BinaryIPAddress("localhost").valid() );
+}
+
+BOOST_AUTO_TEST_CASE( test_binary_format )
+{
+    BOOST_CHECK_EQUAL( BinaryIPAddress("127.0.0.1").address_string(), "127.0.0.1" );
+    BOOST_CHECK_EQUAL( BinaryIPAddress("::").address_string(), "::" );
+    BOOST_CHECK_EQUAL( BinaryIPAddress("::1").address_string(), "::1" );
+    BOOST_CHECK_EQUAL( BinaryIPAddress("1::").address_string(), "1::" );
+    BOOST_CHECK_EQUAL( BinaryIPAddress("2001:0DB8:0:0:1:0:0:1").address_string(), "2001:db8::1:0:0:1" );
+    BOOST_CHECK_EQUAL( BinaryIPAddress("1:0:2:3:4:5:6:7").address_string(), "1:0:2:3:4:5:6:7" );
+    BOOST_CHECK_EQUAL( BinaryIPAddress("::ffff:1.2.3.4").address_string(), "::ffff:1.2.3.4" );
+    BOOST_CHECK_EQUAL( BinaryIPAddress().address_string(), "" );
+
+    boost::test_tools::output_test_stream test;
+    test << BinaryIPAddress("::1", 80);
+    BOOST_CHECK( test.is_equal( "[::1]:80" ) );
+
+    IPAddress address = BinaryIPAddress("10.0.0.1", 8080).to_ip_address();
+    BOOST_CHECK( address.type == IPAddress::Type::IPv4 );
+    BOOST_CHECK( address.string == "10.0.0.1" );
+    BOOST_CHECK( address.port == 8080 );
+}
+
+BOOST_AUTO_TEST_CASE( test_access_list )
+{
+    IPAccessList list;
+    BOOST_CHECK( list.empty() );
+    BOOST_CHECK( list.allowed(BinaryIPAddress("192.168.1.1")) );
+
+    BOOST_CHECK( list.deny("10.0.0.0/8") );
+    BOOST_CHECK( list.allow("10.1.0.0/16") );
+    BOOST_CHECK( list.deny("10.1.2.3") );
+    BOOST_CHECK( list.deny("2001:db8::/32") );
+    BOOST_CHECK( !list.empty() );
+
+    BOOST_CHECK( !list.allowed(BinaryIPAddress("10.2.0.1")) );
+    BOOST_CHECK( list.allowed(BinaryIPAddress("10.1.0.1")) );
+    BOOST_CHECK( !list.allowed(BinaryIPAddress("10.1.2.3")) );
+    BOOST_CHECK( list.allowed(BinaryIPAddress("11.0.0.1")) );
+    BOOST_CHECK( !list.allowed(BinaryIPAddress("::ffff:10.2.0.1")) );
+    BOOST_CHECK( !list.allowed(BinaryIPAddress("2001:db8:1::1")) );
+    BOOST_CHECK( list.allowed(BinaryIPAddress("2001:db9::1")) );
+    BOOST_CHECK( list.allowed(BinaryIPAddress()) );
+
+    BOOST_CHECK( !list.add("10.0.0.0/33", IPAccessList::Rule::Deny) );
+    BOOST_CHECK( !list.add("::/129", IPAccessList::Rule::Deny) );
+    BOOST_CHECK( !list.add("10.0.0.0/", IPAccessList::Rule::Deny) );
+    BOOST_CHECK( !list.add("10.0.0.0/x", IPAccessList::Rule::Deny) );
+    BOOST_CHECK( !list.add("example.com", IPAccessList::Rule::Deny) );
+
+    list.set_default_rule(IPAccessList::Rule::Deny);
+    BOOST_CHECK( !list.allowed(BinaryIPAddress("11.0.0.1")) );
+    BOOST_CHECK( list.allowed(BinaryIPAddress("10.1.0.1")) );
+
+    BOOST_CHECK( list.allow("::/0") );
+    BOOST_CHECK( list.allowed(BinaryIPAddress("11.0.0.1")) );
+
+    list.clear();
+    BOOST_CHECK( list.empty() );
+    BOOST_CHECK( !list.allowed(BinaryIPAddress("10.1.0.1")) );
+}
@@ -18,12 +18,51 @@
  */
 #define BOOST_TEST_MODULE Test_Json
 
+#include <cstring>
+
 #include <boost/test/unit_test.hpp>
 
 #include "httpony/formats/json.hpp"
+#include "httpony/formats/json_index.hpp"
+#include "httpony/formats/json_stream.hpp"
+#include "httpony/formats/json_writer.hpp"
+#include "httpony/formats/json_binding.hpp"
+#include "httpony/formats/ndjson.hpp"
 
 using namespace httpony::json;
 
+namespace test {
+
+struct Point
+{
+    int x = 0;
+    double y = 0;
+};
+
+struct Shape
+{
+    std::string name;
+    std::vector<Point> points;
+    melanolib::Optional<std::string> color;
+    bool closed = false;
+    unsigned id = 0;
+};
+
+} // namespace test
+
+HTTPONY_JSON_BINDING(test::Point,
+    HTTPONY_JSON_FIELD(x),
+    HTTPONY_JSON_FIELD(y)
+)
+
+HTTPONY_JSON_BINDING(test::Shape,
+    HTTPONY_JSON_FIELD(name),
+    HTTPONY_JSON_FIELD(points),
+    HTTPONY_JSON_FIELD(color),
+    httpony::json::field("is_closed", &test::Shape::closed),
+    HTTPONY_JSON_FIELD(id)
+)
+
 BOOST_AUTO_TEST_CASE( test_ptree_array )
 {
     JsonParserPtree parser;
@@ -763,3 +802,577 @@ BOOST_AUTO_TEST_CASE( test_unicode_surrogates_encode )
     BOOST_CHECK_EQUAL( out.str(), R"(["\ud83d\udd25"])" );
 }
 
+
+/**
+ * \brief Straightforward implementation of the structural index
+ */
+static std::vector<StructuralIndex::position_type> naive_index(const std::string& json)
+{
+    std::vector<StructuralIndex::position_type> result;
+    bool in_string = false;
+    bool in_scalar = false;
+    for ( std::size_t i = 0; i < json.size(); i++ )
+    {
+        char c = json[i];
+        if ( in_string )
+        {
+            if ( c == '\\' )
+                i++;
+            else if ( c == '"' )
+                in_string = false;
+            continue;
+        }
+
+        if ( c == '"' )
+        {
+            in_string = true;
+            in_scalar = false;
+            result.push_back(i);
+        }
+        else if ( std::strchr("{}[]:,", c) )
+        {
+            in_scalar = false;
+            result.push_back(i);
+        }
+        else if ( std::strchr(" \t\n\r", c) )
+        {
+            in_scalar = false;
+        }
+        else
+        {
+            if ( !in_scalar )
+                result.push_back(i);
+            in_scalar = true;
+            // Backslashes escape quotes and backslashes outside strings too
+            if ( c == '\\' && i + 1 < json.size() &&
+                    (json[i+1] == '"' || json[i+1] == '\\') )
+                i++;
+        }
+    }
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE( test_structural_index )
+{
+    StructuralIndex index;
+    BOOST_CHECK( index.build("", 0) );
+    BOOST_CHECK_EQUAL( index.size(), 0u );
+
+    std::string json = R"({"a\"b": [12, true, "x\\"]})";
+    BOOST_CHECK( index.build(json.data(), json.size()) );
+    std::vector<StructuralIndex::position_type> expected = {
+        0, 1, 7, 9, 10, 12, 14, 18, 20, 25, 26
+    };
+    BOOST_CHECK( index.positions() == expected );
+
+    json = R"(["abc)";
+    BOOST_CHECK( !index.build(json.data(), json.size()) );
+}
+
+BOOST_AUTO_TEST_CASE( test_structural_index_blocks )
+{
+    // Escape sequences, strings and literals straddling 64 byte blocks
+    const std::string pieces[] = {
+        "\\", "\\\\", "\\\"", "\"", "a", "1", " ", ",", "{", "]", ":"
+    };
+    unsigned seed = 1;
+    StructuralIndex index;
+    for ( int test = 0; test < 2000; test++ )
+    {
+        std::string json;
+        std::size_t length = 1 + test % 200;
+        while ( json.size() < length )
+        {
+            seed = seed * 1103515245 + 12345;
+            json += pieces[(seed >> 16) % (sizeof(pieces) / sizeof(pieces[0]))];
+        }
+        auto expected = naive_index(json);
+
+        for ( bool simd : {true, false} )
+        {
+            bool terminated = index.build(json.data(), json.size(), simd);
+            // Only compare the indices of valid strings
+            if ( terminated )
+                BOOST_CHECK( index.positions() == expected );
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_indexed_parser )
+{
+    JsonIndexedParser parser;
+    JsonNode tree = parser.parse_string(
+        R"({"foo": {"bar": [1, -2.5e3, "x\tyè🔥"]},)"
+        R"( "t": true, "f": false, "n": null, "e": {}, "a": []})"
+    );
+    BOOST_CHECK( !parser.error() );
+    BOOST_CHECK_EQUAL( tree.get<int>("foo.bar.0"), 1 );
+    BOOST_CHECK_EQUAL( tree.get<double>("foo.bar.1"), -2500 );
+    BOOST_CHECK_EQUAL( tree.get<std::string>("foo.bar.2"), "x\ty\xc3\xa8\xF0\x9F\x94\xA5" );
+    BOOST_CHECK_EQUAL( tree.get<bool>("t"), true );
+    BOOST_CHECK_EQUAL( tree.get<bool>("f"), false );
+    BOOST_CHECK( tree.get_child("n").type() == JsonNode::Null );
+    BOOST_CHECK( tree.get_child("e").type() == JsonNode::Object );
+    BOOST_CHECK( tree.get_child("a").type() == JsonNode::Array );
+
+    JsonParser reference;
+    std::string json = R"([{"a": "b\"c", "d": [[1, 2], {"e": 3}]}, 4])";
+    std::ostringstream expected, actual;
+    reference.parse_string(json).format(expected);
+    parser.parse_string(json).format(actual);
+    BOOST_CHECK_EQUAL( actual.str(), expected.str() );
+}
+
+BOOST_AUTO_TEST_CASE( test_indexed_parser_errors )
+{
+    JsonIndexedParser parser;
+    BOOST_CHECK_THROW( parser.parse_string("[1, 2"), JsonError );
+    BOOST_CHECK_THROW( parser.parse_string("[1 2]"), JsonError );
+    BOOST_CHECK_THROW( parser.parse_string("{\"a\" 1}"), JsonError );
+    BOOST_CHECK_THROW( parser.parse_string("{a: 1}"), JsonError );
+    BOOST_CHECK_THROW( parser.parse_string("[01]"), JsonError );
+    BOOST_CHECK_THROW( parser.parse_string("[1.]"), JsonError );
+    BOOST_CHECK_THROW( parser.parse_string("[\"a]"), JsonError );
+    BOOST_CHECK_THROW( parser.parse_string("{} {}"), JsonError );
+
+    // Strings
+    BOOST_CHECK_THROW( parser.parse_string(R"(["\q"])"), JsonError );
+    BOOST_CHECK_THROW( parser.parse_string(R"(["\'"])"), JsonError );
+    BOOST_CHECK_THROW( parser.parse_string(R"(["\x41"])"), JsonError );
+    BOOST_CHECK_THROW( parser.parse_string("[\"a\x01b\"]"), JsonError );
+    BOOST_CHECK_THROW( parser.parse_string("[\"a\nb\"]"), JsonError );
+    BOOST_CHECK_THROW( parser.parse_string(R"(["\u12"])"), JsonError );
+    BOOST_CHECK_THROW( parser.parse_string(R"(["\ud83d"])"), JsonError );
+    BOOST_CHECK_THROW( parser.parse_string(R"(["\ud83dx"])"), JsonError );
+    BOOST_CHECK_THROW( parser.parse_string(R"(["\ud83d\n"])"), JsonError );
+    BOOST_CHECK_THROW( parser.parse_string(R"(["\ud83d\u0041"])"), JsonError );
+    BOOST_CHECK_THROW( parser.parse_string(R"(["\ude00"])"), JsonError );
+    BOOST_CHECK_EQUAL(
+        parser.parse_string(R"(["\ud83d\ude00 \/\"\\\b\f\n\r\t"])").get<std::string>("0"),
+        "\xf0\x9f\x98\x80 /\"\\\b\f\n\r\t"
+    );
+
+    parser.throws(false);
+    parser.parse_string("[1, 2,]");
+    BOOST_CHECK( parser.error() );
+    parser.parse_string("[1, 2]");
+    BOOST_CHECK( !parser.error() );
+
+    try {
+        parser.throws(true);
+        parser.parse_string("[\n1,\n2,\n]", "foo.json");
+        BOOST_FAIL("Should have thrown");
+    } catch ( const JsonError& err ) {
+        BOOST_CHECK_EQUAL( err.file, "foo.json" );
+        BOOST_CHECK_EQUAL( err.line, 4 );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_indexed_parser_handler )
+{
+    struct Counter : JsonHandler
+    {
+        bool number(const std::string& raw)
+        {
+            numbers++;
+            return numbers < 2;
+        }
+        int numbers = 0;
+    };
+
+    JsonIndexedParser parser;
+    Counter counter;
+    std::string json = "[1, 2, 3]";
+    BOOST_CHECK( !parser.parse(json.data(), json.size(), counter) );
+    BOOST_CHECK_EQUAL( counter.numbers, 2 );
+}
+
+BOOST_AUTO_TEST_CASE( test_reader_events )
+{
+    using Event = JsonReader::Event;
+    std::istringstream input(R"({"a": [1, "x\n"], "b": {}, "c": [], "d": null, "e": false})");
+    JsonReader reader(input);
+
+    std::vector<std::pair<Event, std::string>> expected = {
+        {Event::StartObject, ""},
+        {Event::Key, "a"},
+        {Event::StartArray, ""},
+        {Event::Number, "1"},
+        {Event::String, "x\n"},
+        {Event::EndArray, ""},
+        {Event::Key, "b"},
+        {Event::StartObject, ""},
+        {Event::EndObject, ""},
+        {Event::Key, "c"},
+        {Event::StartArray, ""},
+        {Event::EndArray, ""},
+        {Event::Key, "d"},
+        {Event::Null, ""},
+        {Event::Key, "e"},
+        {Event::Boolean, "false"},
+        {Event::EndObject, ""},
+        {Event::End, ""},
+    };
+
+    for ( const auto& item : expected )
+    {
+        BOOST_CHECK( reader.next() == item.first );
+        if ( !item.second.empty() )
+            BOOST_CHECK_EQUAL( reader.value(), item.second );
+    }
+    BOOST_CHECK( reader.next() == Event::End );
+}
+
+BOOST_AUTO_TEST_CASE( test_reader_skip )
+{
+    using Event = JsonReader::Event;
+    std::istringstream input(R"([{"a": [1, [2]], "b": {"c": 3}}, 4])");
+    JsonReader reader(input);
+
+    BOOST_CHECK( reader.next() == Event::StartArray );
+    BOOST_CHECK( reader.next() == Event::StartObject );
+    BOOST_CHECK_EQUAL( reader.path(), "0" );
+    reader.skip();
+    BOOST_CHECK( reader.event() == Event::EndObject );
+    BOOST_CHECK( reader.next() == Event::Number );
+    BOOST_CHECK_EQUAL( reader.path(), "1" );
+    BOOST_CHECK_EQUAL( reader.value(), "4" );
+    BOOST_CHECK( reader.next() == Event::EndArray );
+    BOOST_CHECK_EQUAL( reader.depth(), 0u );
+}
+
+BOOST_AUTO_TEST_CASE( test_reader_extract )
+{
+    std::istringstream input(R"({"records": [
+        {"id": 1, "data": {"x": [1, 2, 3]}},
+        {"id": 2, "data": {"x": []}, "extra": {"id": 5}}
+    ], "count": 2})");
+    JsonReader reader(input);
+
+    std::vector<std::string> found;
+    BOOST_CHECK( reader.extract({"records.*.id", "count", "records.1.data"},
+        [&found](const std::string& path, const JsonNode& node) {
+            std::ostringstream ss;
+            node.format(ss);
+            found.push_back(path + "=" + ss.str());
+            return true;
+        }
+    ) );
+
+    std::vector<std::string> expected = {
+        "records.0.id=1",
+        "records.1.id=2",
+        "records.1.data={\"x\":[]}",
+        "count=2",
+    };
+    BOOST_CHECK( found == expected );
+}
+
+BOOST_AUTO_TEST_CASE( test_reader_early_stop )
+{
+    // The stream is invalid after the first record, which is never read
+    std::istringstream input(R"([{"id": 1}, {"id": 2}, {"id": )");
+    JsonReader reader(input);
+
+    int calls = 0;
+    BOOST_CHECK( !reader.extract({"*"},
+        [&calls](const std::string& path, const JsonNode& node) {
+            calls++;
+            return node.get<int>("id") != 2;
+        }
+    ) );
+    BOOST_CHECK_EQUAL( calls, 2 );
+
+    std::istringstream truncated(R"([{"id": 1}, {"id": )");
+    JsonReader failing(truncated);
+    JsonHandler handler;
+    BOOST_CHECK_THROW( failing.parse(handler), JsonError );
+}
+
+BOOST_AUTO_TEST_CASE( test_reader_handler )
+{
+    std::string json = R"({"a": [1, 2.5, "b"], "c": {"d": true}})";
+    std::istringstream input(json);
+    JsonReader reader(input);
+    JsonTreeBuilder builder;
+    BOOST_CHECK( reader.parse(builder) );
+
+    std::ostringstream expected, actual;
+    JsonParser().parse_string(json).format(expected);
+    builder.tree().format(actual);
+    BOOST_CHECK_EQUAL( actual.str(), expected.str() );
+}
+
+BOOST_AUTO_TEST_CASE( test_reader_strings )
+{
+    auto read = [](const std::string& json) {
+        std::istringstream input(json);
+        JsonReader reader(input);
+        reader.next();
+        return reader.value();
+    };
+
+    BOOST_CHECK_EQUAL( read(R"("\ud83d\ude00 \/\"\\\b\f\n\r\t")"), "\xf0\x9f\x98\x80 /\"\\\b\f\n\r\t" );
+
+    BOOST_CHECK_THROW( read(R"("\q")"), JsonError );
+    BOOST_CHECK_THROW( read(R"("\'")"), JsonError );
+    BOOST_CHECK_THROW( read(R"("\x41")"), JsonError );
+    BOOST_CHECK_THROW( read("\"a\x01b\""), JsonError );
+    BOOST_CHECK_THROW( read("\"a\nb\""), JsonError );
+    BOOST_CHECK_THROW( read(R"("\u12")"), JsonError );
+    BOOST_CHECK_THROW( read(R"("\ud83d")"), JsonError );
+    BOOST_CHECK_THROW( read(R"("\ud83dx")"), JsonError );
+    BOOST_CHECK_THROW( read(R"("\ud83d\u0041")"), JsonError );
+    BOOST_CHECK_THROW( read(R"("\ude00")"), JsonError );
+    BOOST_CHECK_THROW( read(R"("\)"), JsonError );
+}
+
+BOOST_AUTO_TEST_CASE( test_writer_compact )
+{
+    std::string out;
+    {
+        JsonWriter writer(out);
+        writer.start_object();
+        writer.member("a", 1);
+        writer.member("b", -12.5);
+        writer.member("c", "x\"/\n\x01");
+        writer.key("d");
+        writer.start_array();
+        writer.value(true).value(nullptr).value(18446744073709551615ull);
+        writer.start_object();
+        writer.end_object();
+        writer.start_array();
+        writer.end_array();
+        writer.end_array();
+        writer.end_object();
+    }
+    BOOST_CHECK_EQUAL( out,
+        R"({"a":1,"b":-12.5,"c":"x\"\/\n\u0001","d":[true,null,18446744073709551615,{},[]]})"
+    );
+}
+
+BOOST_AUTO_TEST_CASE( test_writer_pretty )
+{
+    std::ostringstream out;
+    JsonWriter writer(out, 2);
+    writer.start_object();
+    writer.member("a", 1);
+    writer.key("b");
+    writer.start_array();
+    writer.value(2).value("c");
+    writer.end_array();
+    writer.end_object();
+    writer.flush();
+    BOOST_CHECK_EQUAL( out.str(), "{\n  \"a\": 1,\n  \"b\": [\n    2,\n    \"c\"\n  ]\n}" );
+}
+
+BOOST_AUTO_TEST_CASE( test_writer_unicode )
+{
+    std::string out;
+    JsonWriter writer(out);
+    writer.value("\xc3\xa8\xF0\x9F\x94\xA5");
+    writer.escape_unicode(false);
+    writer.value("\xc3\xa8\xF0\x9F\x94\xA5");
+    writer.flush();
+    BOOST_CHECK_EQUAL( out, "\"\\u00e8\\ud83d\\udd25\"\"\xc3\xa8\xF0\x9F\x94\xA5\"" );
+}
+
+BOOST_AUTO_TEST_CASE( test_writer_tree )
+{
+    JsonNode tree = JsonParser().parse_string(
+        R"({"a": [1, 2.5, "b/c"], "c": {"d": true, "e": null}})"
+    );
+    std::ostringstream expected;
+    tree.format(expected);
+
+    std::string out;
+    JsonWriter writer(out);
+    writer.value(tree);
+    writer.flush();
+    BOOST_CHECK_EQUAL( out, expected.str() );
+
+    // Large output bypasses the staging buffer
+    std::string big(10000, 'x');
+    std::ostringstream stream;
+    JsonWriter stream_writer(stream);
+    stream_writer.start_array();
+    stream_writer.value(big).value(big);
+    stream_writer.end_array();
+    stream_writer.flush();
+    BOOST_CHECK_EQUAL( stream.str(), "[\"" + big + "\",\"" + big + "\"]" );
+}
+
+BOOST_AUTO_TEST_CASE( test_writer_forward )
+{
+    std::string json = R"({"a":[1,2.5,"b"],"c":{"d":true,"e":null}})";
+    std::istringstream input(json);
+    JsonReader reader(input);
+    std::string out;
+    JsonWriter writer(out);
+    BOOST_CHECK( reader.parse(writer) );
+    writer.flush();
+    BOOST_CHECK_EQUAL( out, json );
+}
+
+BOOST_AUTO_TEST_CASE( test_binding_write )
+{
+    test::Shape shape;
+    shape.name = "tri";
+    shape.points = {{1, 2.5}, {-3, 4}};
+    shape.closed = true;
+    shape.id = 7;
+    BOOST_CHECK_EQUAL( to_json(shape),
+        R"({"name":"tri","points":[{"x":1,"y":2.5},{"x":-3,"y":4}],"color":null,"is_closed":true,"id":7})"
+    );
+    shape.color = std::string("red");
+    BOOST_CHECK( to_json(shape).find(R"("color":"red")") != std::string::npos );
+}
+
+BOOST_AUTO_TEST_CASE( test_binding_read )
+{
+    auto shape = from_json<test::Shape>(
+        R"({"id": 3, "unknown": {"a": [1, {}]}, "points": [{"y": 1.5, "x": 2}],)"
+        R"( "color": "blue", "is_closed": true, "name": "line"})"
+    );
+    BOOST_CHECK_EQUAL( shape.name, "line" );
+    BOOST_CHECK_EQUAL( shape.id, 3u );
+    BOOST_CHECK( shape.closed );
+    BOOST_CHECK( shape.color && *shape.color == "blue" );
+    BOOST_CHECK_EQUAL( shape.points.size(), 1u );
+    BOOST_CHECK_EQUAL( shape.points[0].x, 2 );
+    BOOST_CHECK_EQUAL( shape.points[0].y, 1.5 );
+
+    test::Shape copy = from_json<test::Shape>(to_json(shape, 4));
+    BOOST_CHECK_EQUAL( to_json(copy), to_json(shape) );
+
+    BOOST_CHECK_THROW( from_json<test::Shape>(R"({"id": "3"})"), JsonError );
+    BOOST_CHECK_THROW( from_json<test::Shape>(R"({"id": -3})"), JsonError );
+    BOOST_CHECK_THROW( from_json<test::Point>(R"({"x": 1.5})"), JsonError );
+    BOOST_CHECK_THROW( from_json<test::Point>(R"([])"), JsonError );
+    BOOST_CHECK_THROW( from_json<test::Point>(R"({"x": 1} 2)"), JsonError );
+}
+
+BOOST_AUTO_TEST_CASE( test_number_format )
+{
+    std::ostringstream out;
+    JsonNode tree;
+    tree.put("a", JsonNode(0.1));
+    tree.put("b", JsonNode(1e300));
+    tree.put("c", JsonNode(-1234567890l));
+    tree.format(out);
+    BOOST_CHECK_EQUAL( out.str(), R"({"a":0.1,"b":1e+300,"c":-1234567890})" );
+    BOOST_CHECK_EQUAL( tree.get<double>("a"), 0.1 );
+}
+
+BOOST_AUTO_TEST_CASE( test_ndjson_ordered )
+{
+    std::string input;
+    for ( int i = 0; i < 1000; i++ )
+    {
+        input += "{\"id\": " + std::to_string(i) + "}\n";
+        if ( i % 100 == 0 )
+            input += "\r\n  \n";
+    }
+
+    NdjsonParser parser(4);
+    parser.chunk_size(7);
+    std::vector<int> ids;
+    BOOST_CHECK( parser.parse_string(input, [&ids](std::size_t sequence, JsonNode&& tree) {
+        BOOST_CHECK_EQUAL( std::size_t(tree.get<int>("id")), sequence );
+        ids.push_back(tree.get<int>("id"));
+        return true;
+    }) );
+    BOOST_CHECK_EQUAL( ids.size(), 1000u );
+    BOOST_CHECK( std::is_sorted(ids.begin(), ids.end()) );
+
+    int calls = 0;
+    BOOST_CHECK( !parser.parse_string(input, [&calls](std::size_t, JsonNode&&) {
+        return ++calls < 10;
+    }) );
+    BOOST_CHECK_EQUAL( calls, 10 );
+}
+
+BOOST_AUTO_TEST_CASE( test_ndjson_unordered )
+{
+    std::string input;
+    for ( int i = 0; i < 1000; i++ )
+        input += "[" + std::to_string(i) + "]\n";
+
+    NdjsonParser parser(4);
+    parser.ordered(false);
+    parser.chunk_size(10);
+    std::vector<bool> seen(1000, false);
+    BOOST_CHECK( parser.parse_string(input, [&seen](std::size_t sequence, JsonNode&& tree) {
+        seen[tree.get<int>("0")] = true;
+        return sequence < 1000;
+    }) );
+    BOOST_CHECK( std::all_of(seen.begin(), seen.end(), [](bool b) { return b; }) );
+}
+
+BOOST_AUTO_TEST_CASE( test_ndjson_errors )
+{
+    std::string input = "{\"a\": 1}\n\n{\"a\": 2}\n{\"a\": }\n{\"a\": 4}\n";
+    for ( bool ordered : {true, false} )
+    {
+        NdjsonParser parser(2);
+        parser.ordered(ordered);
+        parser.chunk_size(1);
+        std::vector<int> values;
+        try {
+            parser.parse_string(input, [&values](std::size_t, JsonNode&& tree) {
+                values.push_back(tree.get<int>("a"));
+                return true;
+            }, "batch");
+            BOOST_FAIL("Should have thrown");
+        } catch ( const JsonError& err ) {
+            BOOST_CHECK_EQUAL( err.file, "batch" );
+            BOOST_CHECK_EQUAL( err.line, 4 );
+        }
+        if ( ordered )
+            BOOST_CHECK( values == std::vector<int>({1, 2}) );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_compiled_path )
+{
+    JsonNode tree = JsonParser().parse_string(R"({"a": {"b": [10, {"c": "x"}]}})");
+    JsonPath path("a.b.1.c");
+    BOOST_CHECK_EQUAL( path.size(), 4u );
+    BOOST_CHECK_EQUAL( path.str(), "a.b.1.c" );
+    BOOST_CHECK_EQUAL( tree.get<std::string>(path), "x" );
+    BOOST_CHECK_EQUAL( tree.get(JsonPath("a.b.0"), 0), 10 );
+    BOOST_CHECK_EQUAL( tree.get(JsonPath("a.z"), 5), 5 );
+    BOOST_CHECK( !tree.get_child_optional(JsonPath("a.z")) );
+
+    JsonPath target("d.e");
+    tree.put(target, 3);
+    BOOST_CHECK_EQUAL( tree.get<int>("d.e"), 3 );
+    tree.put(target, 4);
+    BOOST_CHECK_EQUAL( tree.get_child("d").size(), 1u );
+    BOOST_CHECK_EQUAL( tree.get<int>(target), 4 );
+
+    BOOST_CHECK_THROW( tree.put(JsonPath(""), 1), JsonError );
+}
+
+BOOST_AUTO_TEST_CASE( test_path_set )
+{
+    JsonNode tree = JsonParser().parse_string(
+        R"({"a": {"b": 1, "c": [2, 3]}, "d": "e"})"
+    );
+    tree.add_child("a", JsonParser().parse_string(R"({"b": 4})")
+    );
+    // The second "a" is ignored, as with get_child()
+    JsonPathSet paths{"a.b", "a.c.1", "d", "missing", "a.c.5", ""};
+    BOOST_CHECK_EQUAL( paths.size(), 6u );
+    BOOST_CHECK_EQUAL( paths.add("a.b"), 6u );
+
+    auto nodes = paths.resolve(tree);
+    BOOST_CHECK_EQUAL( nodes.size(), 7u );
+    BOOST_CHECK( nodes[0] == &tree.get_child("a.b") );
+    BOOST_CHECK( nodes[1] == &tree.get_child("a.c.1") );
+    BOOST_CHECK( nodes[2] && nodes[2]->get_value<std::string>() == "e" );
+    BOOST_CHECK( !nodes[3] );
+    BOOST_CHECK( !nodes[4] );
+    BOOST_CHECK( nodes[5] == &tree );
+    BOOST_CHECK( nodes[6] == nodes[0] );
+}
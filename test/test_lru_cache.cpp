@@ -0,0 +1,88 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#define BOOST_TEST_MODULE HttPony_LruCache
+#include <boost/test/unit_test.hpp>
+
+#include "httpony/util/lru_cache.hpp"
+#include "httpony/http/user_agent.hpp"
+
+using namespace httpony;
+
+BOOST_AUTO_TEST_CASE( test_eviction )
+{
+    LruCache<int, std::string> cache(2);
+    cache.insert(1, "one");
+    cache.insert(2, "two");
+    BOOST_REQUIRE( cache.find(1) );
+    BOOST_CHECK_EQUAL( *cache.find(1), "one" );
+
+    // 2 is the least recently used now
+    cache.insert(3, "three");
+    BOOST_CHECK_EQUAL( cache.size(), 2u );
+    BOOST_CHECK( cache.find(1) );
+    BOOST_CHECK( !cache.find(2) );
+    BOOST_CHECK( cache.find(3) );
+
+    cache.insert(1, "uno");
+    BOOST_CHECK_EQUAL( *cache.find(1), "uno" );
+    BOOST_CHECK_EQUAL( cache.size(), 2u );
+}
+
+BOOST_AUTO_TEST_CASE( test_sharded )
+{
+    ShardedLruCache<int, int> cache(64, 4);
+    int created = 0;
+    auto create = [&created](int key) { created++; return key * 2; };
+
+    for ( int i = 0; i < 3; i++ )
+        BOOST_CHECK_EQUAL( cache.get(21, create), 42 );
+    BOOST_CHECK_EQUAL( created, 1 );
+
+    for ( int i = 0; i < 1000; i++ )
+        cache.get(i, create);
+    BOOST_CHECK( cache.size() <= 64u );
+
+    cache.clear();
+    BOOST_CHECK_EQUAL( cache.size(), 0u );
+}
+
+BOOST_AUTO_TEST_CASE( test_user_agent_cache )
+{
+    std::string string = "Mozilla/5.0 Gecko/20100101 Firefox/47.0";
+    UserAgent first = UserAgentCache::instance().parse(string);
+    UserAgent second = UserAgentCache::instance().parse(string);
+    BOOST_CHECK_EQUAL( first.size(), 3u );
+    BOOST_CHECK_EQUAL( second.string(), string );
+
+    // Changing a copy doesn't affect the cached value
+    first.append_product("Pony", "1.0");
+    BOOST_CHECK_EQUAL( first.size(), 4u );
+    BOOST_CHECK_EQUAL( second.size(), 3u );
+    BOOST_CHECK_EQUAL( UserAgentCache::instance().parse(string).size(), 3u );
+
+    second += first;
+    BOOST_CHECK_EQUAL( second.size(), 7u );
+    BOOST_CHECK_EQUAL( first.size(), 4u );
+    BOOST_CHECK_EQUAL( UserAgentCache::instance().parse(string).size(), 3u );
+}
@@ -0,0 +1,192 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#define BOOST_TEST_MODULE HttPony_MemoryBudget
+#include <boost/test/unit_test.hpp>
+
+/// \cond
+#include <thread>
+/// \endcond
+
+#include "httpony/io/memory_budget.hpp"
+
+using namespace httpony::io;
+
+BOOST_AUTO_TEST_CASE( test_account )
+{
+    MemoryBudget budget;
+    {
+        MemoryAccount account;
+        BOOST_CHECK( account.update(MemoryAccount::Input, 100) );
+        account.set(MemoryAccount::Output, 50);
+        BOOST_CHECK_EQUAL( account.used(), 150u );
+        BOOST_CHECK_EQUAL( account.used(MemoryAccount::Input), 100u );
+
+        // Bytes held before attaching are charged to the budget
+        account.attach(&budget);
+        BOOST_CHECK_EQUAL( budget.used(), 150u );
+        BOOST_CHECK_EQUAL( budget.stats().connections, 1u );
+
+        BOOST_CHECK( account.update(MemoryAccount::Input, 10) );
+        BOOST_CHECK_EQUAL( account.used(), 60u );
+        BOOST_CHECK_EQUAL( budget.used(), 60u );
+    }
+
+    BOOST_CHECK_EQUAL( budget.used(), 0u );
+    BOOST_CHECK_EQUAL( budget.stats().connections, 0u );
+    BOOST_CHECK_EQUAL( budget.stats().peak, 150u );
+}
+
+BOOST_AUTO_TEST_CASE( test_backpressure )
+{
+    MemoryBudget budget(100);
+    budget.set_backpressure_timeout(std::chrono::milliseconds(10));
+
+    MemoryAccount first;
+    MemoryAccount second;
+    first.attach(&budget);
+    second.attach(&budget);
+
+    BOOST_CHECK( first.update(MemoryAccount::Body, 80) );
+    BOOST_CHECK( !second.update(MemoryAccount::Body, 30) );
+    BOOST_CHECK_EQUAL( second.used(), 0u );
+    BOOST_CHECK_EQUAL( budget.stats().denied, 1u );
+
+    // Recorded anyway
+    second.set(MemoryAccount::Output, 30);
+    BOOST_CHECK_EQUAL( budget.used(), 110u );
+    second.set(MemoryAccount::Output, 0);
+
+    budget.set_backpressure_timeout(std::chrono::seconds(10));
+    second.set_can_wait(true);
+    std::thread releaser([&first]{
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        first.update(MemoryAccount::Body, 0);
+    });
+    BOOST_CHECK( second.update(MemoryAccount::Body, 30) );
+    releaser.join();
+
+    BOOST_CHECK_EQUAL( budget.used(), 30u );
+    BOOST_CHECK_EQUAL( budget.stats().largest, 30u );
+}
+
+BOOST_AUTO_TEST_CASE( test_backpressure_no_wait )
+{
+    MemoryBudget budget(100);
+    budget.set_backpressure_timeout(std::chrono::seconds(10));
+    auto start = std::chrono::steady_clock::now();
+
+    MemoryAccount first;
+    MemoryAccount second;
+    first.attach(&budget);
+    second.attach(&budget);
+    first.set_can_wait(true);
+    second.set_can_wait(true);
+
+    // The only account holding memory can't wait for itself
+    BOOST_CHECK( first.update(MemoryAccount::Body, 80) );
+    BOOST_CHECK( !first.update(MemoryAccount::Body, 120) );
+
+    // The largest account doesn't wait for smaller ones
+    BOOST_CHECK( second.update(MemoryAccount::Body, 10) );
+    BOOST_CHECK( !first.update(MemoryAccount::Body, 95) );
+
+    // Can't grow beyond the limit at all
+    BOOST_CHECK( !second.update(MemoryAccount::Body, 200) );
+
+    // Accounts which may not wait are denied right away
+    second.set_can_wait(false);
+    BOOST_CHECK( !second.update(MemoryAccount::Body, 30) );
+
+    BOOST_CHECK_EQUAL( budget.stats().denied, 4u );
+    BOOST_CHECK( std::chrono::steady_clock::now() - start < std::chrono::seconds(5) );
+}
+
+BOOST_AUTO_TEST_CASE( test_shed )
+{
+    MemoryBudget budget(100, MemoryBudget::Policy::Shed);
+
+    MemoryAccount large;
+    MemoryAccount small;
+    large.attach(&budget);
+    small.attach(&budget);
+
+    BOOST_CHECK( large.update(MemoryAccount::Input, 90) );
+    BOOST_CHECK( small.update(MemoryAccount::Input, 5) );
+
+    // The largest consumer is marked to be dropped, but the limit holds
+    // until it actually releases its memory
+    BOOST_CHECK( !small.update(MemoryAccount::Input, 20) );
+    BOOST_CHECK( large.shed() );
+    BOOST_CHECK( !small.shed() );
+    BOOST_CHECK_EQUAL( budget.stats().shed, 1u );
+    BOOST_CHECK_EQUAL( budget.used(), 95u );
+
+    // Marked accounts don't get any more memory
+    BOOST_CHECK( !large.update(MemoryAccount::Input, 100) );
+
+    large.attach(nullptr);
+    BOOST_CHECK( small.update(MemoryAccount::Input, 20) );
+
+    // The growing connection is the largest one
+    BOOST_CHECK( !small.update(MemoryAccount::Input, 200) );
+    BOOST_CHECK_EQUAL( small.used(), 20u );
+}
+
+BOOST_AUTO_TEST_CASE( test_shed_idle_victim )
+{
+    MemoryBudget budget(100, MemoryBudget::Policy::Shed);
+    budget.set_backpressure_timeout(std::chrono::seconds(10));
+
+    // Holds a request body, without reading anything else
+    MemoryAccount victim;
+    victim.attach(&budget);
+    BOOST_CHECK( victim.update(MemoryAccount::Body, 80) );
+
+    MemoryAccount first;
+    MemoryAccount second;
+    first.attach(&budget);
+    second.attach(&budget);
+
+    BOOST_CHECK( !first.update(MemoryAccount::Body, 30) );
+    BOOST_CHECK( victim.shed() );
+
+    // The memory promised by the victim covers this one too,
+    // no other connection is marked and the limit isn't exceeded
+    BOOST_CHECK( first.update(MemoryAccount::Body, 15) );
+    BOOST_CHECK( !second.update(MemoryAccount::Body, 10) );
+    BOOST_CHECK( !first.shed() );
+    BOOST_CHECK_EQUAL( budget.stats().shed, 1u );
+    BOOST_CHECK( budget.used() <= 100u );
+
+    // Waiting connections get the memory once the victim is dropped
+    second.set_can_wait(true);
+    std::thread dropper([&victim]{
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        victim.set(MemoryAccount::Body, 0);
+    });
+    BOOST_CHECK( second.update(MemoryAccount::Body, 30) );
+    dropper.join();
+    BOOST_CHECK_EQUAL( budget.used(), 45u );
+    BOOST_CHECK_EQUAL( budget.stats().shed, 1u );
+}
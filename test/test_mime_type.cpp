@@ -24,7 +24,13 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/test/output_test_stream.hpp>
 
+#include <cstdio>
+#include <sstream>
+
+#include <unistd.h>
+
 #include "httpony/mime_type.hpp"
+#include "httpony/mime_resolver.hpp"
 
 using namespace httpony;
 
@@ -113,3 +119,126 @@ BOOST_AUTO_TEST_CASE( test_matches_type )
     BOOST_CHECK( MimeType("text", "plain", {"charset", "utf-8"}).matches_type(MimeType("text", "plain", {"charset", "ascii"})) );
 }
 
+
+BOOST_AUTO_TEST_CASE( test_uncommon_types )
+{
+    MimeType common("Text/HTML");
+    MimeType uncommon("Text/X-Pony");
+    BOOST_CHECK( common.name() == "text/html" );
+    BOOST_CHECK( uncommon.name() == "text/x-pony" );
+    BOOST_CHECK( uncommon.matches_type("text", "x-pony") );
+    BOOST_CHECK( uncommon == MimeType("text", "x-pony") );
+    BOOST_CHECK( uncommon != common );
+    BOOST_CHECK( !uncommon.matches_type(common) );
+
+    MimeType changed("text", "html");
+    changed.set_subtype("x-pony");
+    BOOST_CHECK( changed == uncommon );
+    changed.set_subtype("HTML");
+    BOOST_CHECK( changed == common );
+    BOOST_CHECK( changed.string() == "text/html" );
+}
+
+BOOST_AUTO_TEST_CASE( test_resolver_extensions )
+{
+    MimeResolver resolver;
+    std::istringstream mime_types(
+        "# comment\n"
+        "text/x-pony     pony ponies\n"
+        "\n"
+        "image/png       png # trailing comment\n"
+    );
+    resolver.load_mime_types(mime_types);
+
+    BOOST_CHECK( resolver.from_extension("a/b.pony") == MimeType("text", "x-pony") );
+    BOOST_CHECK( resolver.from_extension("b.PONIES") == MimeType("text", "x-pony") );
+    BOOST_CHECK( resolver.from_extension("b.html") == MimeType("text", "html") );
+    BOOST_CHECK( !resolver.from_extension("b.unknown").valid() );
+    BOOST_CHECK( !resolver.from_extension("a.pony/b").valid() );
+    BOOST_CHECK( resolver.resolve("b.unknown") == MimeType("application", "octet-stream") );
+}
+
+BOOST_AUTO_TEST_CASE( test_resolver_sniff_cache )
+{
+    char filename[] = "/tmp/httpony-XXXXXX";
+    int file = mkstemp(filename);
+    BOOST_REQUIRE( file != -1 );
+    close(file);
+
+    int sniffed = 0;
+    MimeResolver resolver([&sniffed](const std::string&) {
+        sniffed++;
+        return MimeType("text", "x-pony");
+    });
+
+    BOOST_CHECK( resolver.resolve(filename) == MimeType("text", "x-pony") );
+    BOOST_CHECK( resolver.resolve(filename) == MimeType("text", "x-pony") );
+    BOOST_CHECK_EQUAL( sniffed, 1 );
+
+    resolver.clear_cache();
+    BOOST_CHECK( resolver.resolve(filename) == MimeType("text", "x-pony") );
+    BOOST_CHECK_EQUAL( sniffed, 2 );
+
+    std::remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE( test_resolver_sniff_cache_changes )
+{
+    char filename[] = "/tmp/httpony-XXXXXX";
+    int file = mkstemp(filename);
+    BOOST_REQUIRE( file != -1 );
+
+    int sniffed = 0;
+    MimeResolver resolver([&sniffed](const std::string&) {
+        sniffed++;
+        return MimeType("text", "x-pony");
+    });
+
+    resolver.resolve(filename);
+    BOOST_CHECK_EQUAL( sniffed, 1 );
+
+    // Most likely within the same second as the first resolve
+    BOOST_REQUIRE( write(file, "pony", 4) == 4 );
+    close(file);
+    resolver.resolve(filename);
+    BOOST_CHECK_EQUAL( sniffed, 2 );
+    resolver.resolve(filename);
+    BOOST_CHECK_EQUAL( sniffed, 2 );
+
+    std::remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE( test_resolver_sniff_cache_eviction )
+{
+    char first[] = "/tmp/httpony-XXXXXX";
+    char second[] = "/tmp/httpony-XXXXXX";
+    char third[] = "/tmp/httpony-XXXXXX";
+    for ( char* filename : {first, second, third} )
+    {
+        int file = mkstemp(filename);
+        BOOST_REQUIRE( file != -1 );
+        close(file);
+    }
+
+    int sniffed = 0;
+    MimeResolver resolver([&sniffed](const std::string&) {
+        sniffed++;
+        return MimeType("text", "x-pony");
+    });
+    resolver.set_cache_size(2);
+
+    resolver.resolve(first);
+    resolver.resolve(second);
+    resolver.resolve(first);
+    BOOST_CHECK_EQUAL( sniffed, 2 );
+
+    // Only the least recently used file is forgotten
+    resolver.resolve(third);
+    resolver.resolve(first);
+    BOOST_CHECK_EQUAL( sniffed, 3 );
+    resolver.resolve(second);
+    BOOST_CHECK_EQUAL( sniffed, 4 );
+
+    for ( char* filename : {first, second, third} )
+        std::remove(filename);
+}
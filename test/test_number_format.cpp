@@ -0,0 +1,139 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#define BOOST_TEST_MODULE HttPony_TestNumberFormat
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+
+#include "httpony/util/number_format.hpp"
+
+using namespace httpony;
+
+/**
+ * \brief Number of significant digits in a formatted number
+ */
+static int significant_digits(const std::string& formatted)
+{
+    std::string digits;
+    for ( char c : formatted.substr(0, formatted.find('e')) )
+        if ( c >= '0' && c <= '9' && (c != '0' || !digits.empty()) )
+            digits += c;
+    while ( !digits.empty() && digits.back() == '0' )
+        digits.pop_back();
+    return digits.size();
+}
+
+/**
+ * \brief Fewest significant digits that read back as \p value
+ */
+static int shortest_digits(double value)
+{
+    char formatted[32];
+    for ( int precision = 0; precision < 16; precision++ )
+    {
+        std::snprintf(formatted, sizeof(formatted), "%.*e", precision, value);
+        if ( std::strtod(formatted, nullptr) == value )
+            return significant_digits(formatted);
+    }
+    return 17;
+}
+
+BOOST_AUTO_TEST_CASE( test_integer )
+{
+    BOOST_CHECK_EQUAL( number::to_string(0ll), "0" );
+    BOOST_CHECK_EQUAL( number::to_string(7ll), "7" );
+    BOOST_CHECK_EQUAL( number::to_string(-42ll), "-42" );
+    BOOST_CHECK_EQUAL( number::to_string(100ll), "100" );
+    BOOST_CHECK_EQUAL( number::to_string(1234567ll), "1234567" );
+    BOOST_CHECK_EQUAL( number::to_string(std::numeric_limits<long long>::min()),
+                       "-9223372036854775808" );
+    BOOST_CHECK_EQUAL( number::to_string(std::numeric_limits<long long>::max()),
+                       "9223372036854775807" );
+    BOOST_CHECK_EQUAL( number::to_string(std::numeric_limits<unsigned long long>::max()),
+                       "18446744073709551615" );
+}
+
+BOOST_AUTO_TEST_CASE( test_double_notation )
+{
+    BOOST_CHECK_EQUAL( number::to_string(0.0), "0" );
+    BOOST_CHECK_EQUAL( number::to_string(-0.0), "-0" );
+    BOOST_CHECK_EQUAL( number::to_string(3.0), "3" );
+    BOOST_CHECK_EQUAL( number::to_string(0.1), "0.1" );
+    BOOST_CHECK_EQUAL( number::to_string(0.3), "0.3" );
+    BOOST_CHECK_EQUAL( number::to_string(-12.5), "-12.5" );
+    BOOST_CHECK_EQUAL( number::to_string(1234.5678), "1234.5678" );
+    BOOST_CHECK_EQUAL( number::to_string(0.000025), "0.000025" );
+    BOOST_CHECK_EQUAL( number::to_string(1e-7), "1e-7" );
+    BOOST_CHECK_EQUAL( number::to_string(1e20), "100000000000000000000" );
+    BOOST_CHECK_EQUAL( number::to_string(1e21), "1e+21" );
+    BOOST_CHECK_EQUAL( number::to_string(5e-324), "5e-324" );
+    BOOST_CHECK_EQUAL( number::to_string(std::numeric_limits<double>::max()),
+                       "1.7976931348623157e+308" );
+    BOOST_CHECK_EQUAL( number::to_string(std::numeric_limits<double>::infinity()), "inf" );
+    BOOST_CHECK_EQUAL( number::to_string(-std::numeric_limits<double>::infinity()), "-inf" );
+    BOOST_CHECK_EQUAL( number::to_string(std::numeric_limits<double>::quiet_NaN()), "nan" );
+}
+
+BOOST_AUTO_TEST_CASE( test_double_shortest )
+{
+    // Values where the digits can't be found with 64 bit arithmetic alone
+    BOOST_CHECK_EQUAL( number::to_string(1e23), "1e+23" );
+    BOOST_CHECK_EQUAL( number::to_string(9e22), "9e+22" );
+    BOOST_CHECK_EQUAL( number::to_string(5e-324), "5e-324" );
+    BOOST_CHECK_EQUAL( number::to_string(1e-323), "1e-323" );
+    BOOST_CHECK_EQUAL( number::to_string(2.2250738585072014e-308), "2.2250738585072014e-308" );
+    BOOST_CHECK_EQUAL( number::to_string(2.225073858507201e-308), "2.225073858507201e-308" );
+    BOOST_CHECK_EQUAL( number::to_string(9007199254740992.0), "9007199254740992" );
+    BOOST_CHECK_EQUAL( number::to_string(9007199254740994.0), "9007199254740994" );
+    BOOST_CHECK_EQUAL( number::to_string(1.7976931348623155e+308), "1.7976931348623155e+308" );
+    BOOST_CHECK_EQUAL( number::to_string(4.940656458412e-324), "5e-324" );
+    BOOST_CHECK_EQUAL( number::to_string(1.2345678901234567e-300), "1.2345678901234568e-300" );
+
+    for ( int exponent = -307; exponent <= 308; exponent++ )
+    {
+        double value = std::strtod(("1e" + std::to_string(exponent)).c_str(), nullptr);
+        std::string formatted = number::to_string(value);
+        BOOST_CHECK_EQUAL( significant_digits(formatted), 1 );
+        BOOST_CHECK_EQUAL( std::strtod(formatted.c_str(), nullptr), value );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_double_roundtrip )
+{
+    std::mt19937_64 random(1);
+    for ( int i = 0; i < 100000; i++ )
+    {
+        uint64_t bits = random();
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        if ( !std::isfinite(value) )
+            continue;
+        std::string formatted = number::to_string(value);
+        BOOST_CHECK_EQUAL( std::strtod(formatted.c_str(), nullptr), value );
+        BOOST_CHECK( formatted.size() < number::max_double_size );
+        BOOST_CHECK_EQUAL( significant_digits(formatted), shortest_digits(value) );
+    }
+}
@@ -25,6 +25,8 @@
 #include <boost/test/output_test_stream.hpp>
 
 #include "httpony/formats/quick_xml.hpp"
+#include "httpony/formats/quick_xml_stream.hpp"
+#include "httpony/formats/quick_xml_template.hpp"
 
 using namespace httpony::quick_xml;
 using namespace httpony::quick_xml::html;
@@ -304,3 +306,258 @@ BOOST_AUTO_TEST_CASE( test_label )
 }
 
 
+
+/**
+ * \brief Writes the same markup as html_document()
+ */
+void html_document_stream(std::ostream& output, const Indentation& indent)
+{
+    HtmlWriter writer(output, "Hello", indent);
+    writer.comment("This is an example");
+    auto p = writer.element("p", Attribute{"id", "content"});
+    writer.attribute("class", "main");
+    writer.text("hello world");
+}
+
+BOOST_AUTO_TEST_CASE( test_stream_matches_tree )
+{
+    std::vector<Indentation> indentations = {
+        Indentation{},
+        Indentation{Indentation::Element|Indentation::Comment},
+        Indentation{Indentation::Element|Indentation::Attribute|Indentation::Comment},
+        Indentation{Indentation::Element|Indentation::Comment|Indentation::CommentText},
+    };
+
+    for ( const auto& indent : indentations )
+    {
+        std::ostringstream tree, stream;
+        html_document().print(tree, indent);
+        html_document_stream(stream, indent);
+        BOOST_CHECK_EQUAL( stream.str(), tree.str() );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_stream_elements )
+{
+    std::ostringstream output;
+    XmlWriter writer(output);
+    {
+        auto list = writer.block_element("ul");
+        for ( auto item : {"a&b", "<c>"} )
+        {
+            auto li = writer.block_element("li");
+            auto link = writer.block_element("a", Attribute{"href", "/x?\"y\""});
+            writer.text(item);
+        }
+        writer.element("br");
+        writer.element("img", Attribute{"src", "i"});
+        writer.block_element("p");
+        writer.node(Link{"/z", "z"});
+        BOOST_CHECK_EQUAL( writer.depth(), 1u );
+    }
+    BOOST_CHECK_EQUAL( writer.depth(), 0u );
+    BOOST_CHECK_EQUAL( output.str(),
+        "<ul>"
+        "<li><a href=\"/x?&quot;y&quot;\">a&amp;b</a></li>"
+        "<li><a href=\"/x?&quot;y&quot;\">&lt;c&gt;</a></li>"
+        "<br/><img src=\"i\"/><p></p>"
+        "<a href=\"/z\">z</a>"
+        "</ul>"
+    );
+
+    {
+        auto p = writer.element("p");
+        writer.text("x");
+        BOOST_CHECK_THROW( writer.attribute("a", "b"), std::logic_error );
+    }
+    BOOST_CHECK_THROW( writer.close(), std::logic_error );
+}
+
+BOOST_AUTO_TEST_CASE( test_template )
+{
+    HtmlDocument document("Page", BlockElement("body",
+        BlockElement("h1", Slot("title", "Default")),
+        Element("a",
+            AttributeSlot("href", "url", "/"),
+            Slot("title"),
+            Slot("extra", "<br/>", false)
+        )
+    ));
+
+    boost::test_tools::output_test_stream output;
+    output << document;
+    BOOST_CHECK( output.is_equal(
+        "<!DOCTYPE html><html><head><title>Page</title></head><body>"
+        "<h1>Default</h1><a href=\"/\"><br/></a></body></html>"
+    ) );
+
+    Template page(document);
+    BOOST_CHECK_EQUAL( page.slot_count(), 3u );
+    BOOST_CHECK_EQUAL( page.slot("title"), 0u );
+    BOOST_CHECK_EQUAL( page.slot("url"), 1u );
+    BOOST_CHECK_EQUAL( page.slot("extra"), 2u );
+    BOOST_CHECK_THROW( page.slot("missing"), std::out_of_range );
+
+    auto values = page.values();
+    values.set("title", "A&B").set("url", "/x?\"y\"").set("extra", "<hr/>");
+    std::string expected =
+        "<!DOCTYPE html><html><head><title>Page</title></head><body>"
+        "<h1>A&amp;B</h1><a href=\"/x?&quot;y&quot;\">A&amp;B<hr/></a></body></html>";
+    BOOST_CHECK_EQUAL( page.render(values), expected );
+
+    std::ostringstream stream;
+    page.render(stream, values);
+    BOOST_CHECK_EQUAL( stream.str(), expected );
+
+    std::string gathered;
+    for ( const auto& buffer : page.gather(values) )
+        gathered.append(
+            boost::asio::buffer_cast<const char*>(buffer),
+            boost::asio::buffer_size(buffer)
+        );
+    BOOST_CHECK_EQUAL( gathered, expected );
+
+    values.set("url", "");
+    BOOST_CHECK_EQUAL( page.render(values),
+        "<!DOCTYPE html><html><head><title>Page</title></head><body>"
+        "<h1>A&amp;B</h1><a href=\"\">A&amp;B<hr/></a></body></html>"
+    );
+}
+
+BOOST_AUTO_TEST_CASE( test_template_indented )
+{
+    BlockElement list("ul",
+        Attribute("class", "list"),
+        BlockElement("li", Slot("first")),
+        BlockElement("li", Slot("second"))
+    );
+    Indentation indent(Indentation::Element);
+
+    Template compiled(list, indent);
+    auto values = compiled.values();
+    values.set("first", "1").set("second", "<2>");
+
+    std::ostringstream tree;
+    BlockElement("ul",
+        Attribute("class", "list"),
+        BlockElement("li", Text("1")),
+        BlockElement("li", Text("<2>"))
+    ).print(tree, indent);
+    BOOST_CHECK_EQUAL( compiled.render(values), tree.str() );
+
+    BlockElement mixed("p", Slot("x"), Slot("x", "", false));
+    BOOST_CHECK_THROW( Template{mixed}, std::logic_error );
+}
+
+namespace {
+
+struct Counted : public Text
+{
+    explicit Counted(int& destroyed) : Text("counted"), destroyed(&destroyed) {}
+    Counted(Counted&& other) : Text(std::move(other)), destroyed(other.destroyed)
+    {
+        other.destroyed = nullptr;
+    }
+    ~Counted()
+    {
+        if ( destroyed )
+            ++*destroyed;
+    }
+    int* destroyed;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE( test_arena_document )
+{
+    auto build = [](HtmlDocument& document) {
+        List& list = document.body().append(document.make<List>());
+        for ( int i = 0; i < 100; i++ )
+            list.add_item(document.make<Link>("/" + std::to_string(i), Text("item & " + std::to_string(i))));
+        document.body().append(document.make<BlockElement>("p", Attribute("class", "x"), Text("end")));
+    };
+
+    HtmlDocument shared("Title");
+    build(shared);
+    BOOST_CHECK( !shared.arena() );
+    BOOST_CHECK( shared.body().children().back().use_count() > 0 );
+
+    HtmlDocument arena = HtmlDocument::with_arena("Title");
+    build(arena);
+    BOOST_CHECK( arena.arena() );
+    BOOST_CHECK( arena.arena()->reserved_size() > 0 );
+    BOOST_CHECK( arena.body().children().back().use_count() == 0 );
+
+    std::ostringstream shared_output, arena_output;
+    shared_output << shared;
+    arena_output << arena;
+    BOOST_CHECK_EQUAL( arena_output.str(), shared_output.str() );
+
+    HtmlDocument moved = std::move(arena);
+    std::ostringstream moved_output;
+    moved_output << moved;
+    BOOST_CHECK_EQUAL( moved_output.str(), shared_output.str() );
+}
+
+BOOST_AUTO_TEST_CASE( test_arena_destruction )
+{
+    int destroyed = 0;
+    {
+        HtmlDocument document = HtmlDocument::with_arena("Title", BlockElement{"body"}, 64);
+        for ( int i = 0; i < 10; i++ )
+            document.body().append(document.make<Counted>(destroyed));
+
+        // Nodes not created through the document are unaffected by its arena
+        auto outside = make_node<Counted>(destroyed);
+        BOOST_CHECK( outside.use_count() == 1 );
+        BlockElement tree("div", Counted(destroyed));
+        BOOST_CHECK( tree.children().back().use_count() == 1 );
+        BOOST_CHECK_EQUAL( destroyed, 0 );
+    }
+    BOOST_CHECK_EQUAL( destroyed, 12 );
+
+    {
+        httpony::Arena arena;
+        auto node = make_arena_node<Counted>(&arena, destroyed);
+        BOOST_CHECK( node.use_count() == 0 );
+        auto shared = make_arena_node<Counted>(nullptr, destroyed);
+        BOOST_CHECK( shared.use_count() == 1 );
+    }
+    BOOST_CHECK_EQUAL( destroyed, 14 );
+}
+
+BOOST_AUTO_TEST_CASE( test_escape )
+{
+    BOOST_CHECK_EQUAL( amp_escape("plain text"), "plain text" );
+    BOOST_CHECK_EQUAL( amp_escape(""), "" );
+    BOOST_CHECK_EQUAL( amp_escape("<a href=\"x\">'&'</a>"),
+        "&lt;a href=&quot;x&quot;&gt;&apos;&amp;&apos;&lt;/a&gt;" );
+
+    // Special characters at every offset around the vector width
+    for ( std::size_t size = 1; size < 40; size++ )
+    {
+        for ( std::size_t i = 0; i < size; i++ )
+        {
+            std::string input(size, 'x');
+            input[i] = '&';
+            std::string expected = input.substr(0, i) + "&amp;" + input.substr(i + 1);
+            BOOST_CHECK_EQUAL( amp_escape(input), expected );
+
+            std::ostringstream stream;
+            amp_escape(stream, input);
+            BOOST_CHECK_EQUAL( stream.str(), expected );
+
+            std::string appended = "-";
+            httpony::escape::xml_append(appended, input);
+            BOOST_CHECK_EQUAL( appended, "-" + expected );
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_escape_script_json )
+{
+    BOOST_CHECK_EQUAL(
+        httpony::escape::script_json("{\"a\":\"</script><b>&'\"}"),
+        "{\"a\":\"\\u003c/script\\u003e\\u003cb\\u003e\\u0026'\"}"
+    );
+}
@@ -0,0 +1,140 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#define BOOST_TEST_MODULE HttPony_Server
+#include <boost/test/unit_test.hpp>
+
+/// \cond
+#include <atomic>
+/// \endcond
+
+#include "httpony.hpp"
+
+using namespace httpony;
+
+/**
+ * \brief Server overriding accept(), which must not bypass the access list
+ */
+class AcceptAllServer : public Server
+{
+public:
+    using Server::Server;
+
+    std::atomic<int> accepted{0};
+    std::atomic<int> responded{0};
+    std::string remote;
+
+    void respond(Request& request, const Status& status) override
+    {
+        remote = request.connection.remote_address_string();
+        responded++;
+        Response response(status);
+        send(request.connection, response);
+    }
+
+protected:
+    void error(io::Connection&, const OperationStatus&) const override
+    {
+    }
+
+private:
+    OperationStatus accept(io::Connection&) override
+    {
+        accepted++;
+        return {};
+    }
+};
+
+BOOST_AUTO_TEST_CASE( test_access_list_override )
+{
+    AcceptAllServer server(IPAddress("127.0.0.1:0"));
+    server.access_list().deny("127.0.0.0/8");
+    server.start();
+
+    Uri uri("http://127.0.0.1:" + std::to_string(server.listen_address().port) + "/");
+    Client client;
+
+    Request request("GET", uri);
+    Response denied;
+    BOOST_CHECK( client.query(request, denied).error() );
+    BOOST_CHECK_EQUAL( server.accepted, 0 );
+    BOOST_CHECK_EQUAL( server.responded, 0 );
+
+    server.access_list().clear();
+    Response allowed;
+    BOOST_CHECK( !client.query(request, allowed).error() );
+    BOOST_CHECK_EQUAL( allowed.status.code, 200 );
+    BOOST_CHECK_EQUAL( server.accepted, 1 );
+    BOOST_CHECK_EQUAL( server.responded, 1 );
+    BOOST_CHECK_EQUAL( server.remote, "127.0.0.1" );
+
+    server.stop();
+}
+
+/**
+ * \brief Server responding with a body of a given size
+ */
+class BodyServer : public Server
+{
+public:
+    using Server::Server;
+
+    std::size_t body_size = 0;
+
+    void respond(Request& request, const Status& status) override
+    {
+        Response response("text/plain", status);
+        response.body << std::string(body_size, 'x');
+        send(request.connection, response);
+    }
+
+protected:
+    void error(io::Connection&, const OperationStatus&) const override
+    {
+    }
+};
+
+BOOST_AUTO_TEST_CASE( test_response_memory )
+{
+    BodyServer server(IPAddress("127.0.0.1:0"));
+    server.memory_budget().set_limit(4000);
+    server.start();
+
+    Uri uri("http://127.0.0.1:" + std::to_string(server.listen_address().port) + "/");
+    Client client;
+    Request request("GET", uri);
+
+    server.body_size = 2000;
+    Response small;
+    BOOST_CHECK( !client.query(request, small).error() );
+    BOOST_CHECK_EQUAL( small.status.code, 200 );
+    BOOST_CHECK( server.memory_budget().stats().peak >= 2000u );
+
+    server.body_size = 5000;
+    Response large;
+    BOOST_CHECK( !client.query(request, large).error() );
+    BOOST_CHECK_EQUAL( large.status.code, 503 );
+    BOOST_CHECK_EQUAL( server.memory_budget().stats().denied, 1u );
+
+    server.stop();
+}
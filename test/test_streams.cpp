@@ -26,6 +26,7 @@
 
 #include "httpony/io/network_stream.hpp"
 #include "httpony/io/buffer.hpp"
+#include "httpony/io/connection.hpp"
 
 using namespace httpony;
 using namespace httpony::io;
@@ -289,3 +290,16 @@ BOOST_AUTO_TEST_CASE( test_input_move_ctor )
     BOOST_CHECK_EQUAL( other_stream.get(), 'e' );
     BOOST_CHECK_EQUAL( other_stream.read_all(true), "Hello\n" );
 }
+
+BOOST_AUTO_TEST_CASE( test_connection_lazy_buffers )
+{
+    Connection connection(SocketTag<PlainSocket>{});
+    // Nothing to write and no buffers to create
+    BOOST_CHECK( !connection.commit_output().error() );
+
+    NetworkOutputBuffer& output = connection.output_buffer();
+    std::ostream(&output) << "Hello";
+    BOOST_CHECK_EQUAL( output.size(), 5u );
+    BOOST_CHECK_EQUAL( &connection.output_buffer(), &output );
+    BOOST_CHECK_EQUAL( connection.input_buffer().size(), 0u );
+}